@@ -0,0 +1,162 @@
+#include "Simulation.h"
+#include "Trace.h"
+#include <stdexcept>
+#include <algorithm>
+
+void Simulation::BatchEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY, GLenum stateFormat, const std::vector<Uniforms>& universes, bool packed)
+{
+	if (universes.empty()) throw std::runtime_error{ "A batch needs at least one universe" };
+
+	channels = packed ? 4 : 1;
+
+	int maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (universes.size() > (size_t)maxLayers * channels) throw std::runtime_error{ "A batch holds at most " + std::to_string(maxLayers * channels) + " universes" };
+
+	for (size_t i = 0; i < universes.size(); i++)
+	{
+		const Uniforms& first = universes[i - i % channels];
+		if (universes[i].ri != first.ri || universes[i].ra != first.ra) throw std::runtime_error{ "Packed universes share ri and ra in groups of four, universe " + std::to_string(i) + " does not" };
+	}
+
+	resX = resolutionX;
+	resY = resolutionY;
+	layers = ((unsigned int)universes.size() + channels - 1) / channels;
+	parameters = universes;
+
+	if (packed)
+	{
+		shader = Shader{ (shaderDir + "batch.vert").c_str(), (shaderDir + "batch.geom").c_str(), (shaderDir + "simulation_batch_packed.frag").c_str() };
+		stateFormat = PackedFormat(stateFormat);
+	}
+	else
+	{
+		shader = Shader{ (shaderDir + "batch.vert").c_str(), (shaderDir + "batch.geom").c_str(), (shaderDir + "simulation_batch.frag").c_str() };
+	}
+
+	shader.Use();
+	shader.SetInt(INPUT_UNIFORM, 0);
+	shader.SetInt("parameters", PARAMETER_UNIT);
+	shader.SetVec2("invResolution", 1.0f / float(resX), 1.0f / float(resY));
+
+	for (int i = 0; i < 2; i++)
+	{
+		glGenFramebuffers(1, &fbos[i]);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+
+		glGenTextures(1, &textures[i]);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, stateFormat, resX, resY, layers, 0, GL_RED, GL_FLOAT, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		// layered, batch.geom picks the layer of every triangle
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures[i], 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Batch framebuffer is not complete" };
+	}
+
+	glGenFramebuffers(1, &readFbo);
+
+	// three RGBA texels per universe, the fields of Uniforms in order
+	// the unused channels of the last packed layer step copies of the last universe
+	std::vector<float> table;
+	table.reserve(layers * channels * 12);
+
+	for (unsigned int i = 0; i < layers * channels; i++)
+	{
+		const Uniforms& uniforms = universes[std::min<size_t>(i, universes.size() - 1)];
+
+		table.insert(table.end(), {
+			uniforms.ri, uniforms.ra, uniforms.dt, uniforms.alpha_m,
+			uniforms.alpha_n, uniforms.b1, uniforms.b2, uniforms.d1,
+			uniforms.d2, 0.0f, 0.0f, 0.0f,
+		});
+	}
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(float), table.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0 + PARAMETER_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	initialised = true;
+}
+
+void Simulation::BatchEngine::Seed(unsigned int seed, bool ensemble)
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textures[front]);
+
+	std::vector<float> texels(resX * resY * channels, 0.0f);
+
+	for (unsigned int layer = 0; layer < layers; layer++)
+	{
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			unsigned int universe = layer * channels + c;
+			if (universe >= parameters.size()) break;
+
+			std::vector<float> cells = SeedState(resX, resY, ensemble ? seed + universe : seed, parameters[universe].ra);
+			for (size_t i = 0; i < cells.size(); i++) texels[i * channels + c] = cells[i];
+		}
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, resX, resY, 1, channels == 4 ? GL_RGBA : GL_RED, GL_FLOAT, texels.data());
+	}
+}
+
+void Simulation::BatchEngine::Step()
+{
+	Trace::Zone zone{ "BatchEngine::Step" };
+
+	glActiveTexture(GL_TEXTURE0 + PARAMETER_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textures[front]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[1 - front]);
+	shader.Use();
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, layers);
+
+	front = 1 - front;
+}
+
+std::vector<float> Simulation::BatchEngine::GetState(unsigned int universe) const
+{
+	if (universe >= parameters.size()) throw std::runtime_error{ "Universe " + std::to_string(universe) + " is not in the batch" };
+
+	std::vector<float> texels(resX * resY * channels);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, readFbo);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textures[front], 0, universe / channels);
+	glReadPixels(0, 0, resX, resY, channels == 4 ? GL_RGBA : GL_RED, GL_FLOAT, texels.data());
+
+	if (channels == 1) return texels;
+
+	std::vector<float> cells(resX * resY);
+	for (size_t i = 0; i < cells.size(); i++) cells[i] = texels[i * channels + universe % channels];
+
+	return cells;
+}
+
+GLenum Simulation::BatchEngine::PackedFormat(GLenum stateFormat)
+{
+	switch (stateFormat)
+	{
+	case GL_R16F: return GL_RGBA16F;
+	case GL_R16: return GL_RGBA16;
+	default: return GL_RGBA32F;
+	}
+}
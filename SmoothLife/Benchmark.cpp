@@ -0,0 +1,417 @@
+#include "Simulation.h"
+#include "CpuEngine.h"
+#include "QuantizedEngine.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+/*
+
+SmoothLifeBench [options]
+
+Runs every step mode, and the CPU engines, on fixed seed workloads over a set of grid sizes
+and kernel radii. After warmup steps each workload is timed repeats times and the median is kept.
+The results go to a JSON file, one workload per line. Given a baseline written by an
+earlier run, every workload that got slower by more than the tolerance is reported and the
+exit code is 1. Without a GPU context the step modes are skipped and the CPU engines still run.
+
+	--size W H        grid size, repeat for several (256 256, 512 512 and 1280 720)
+	--radius RI RA    inner and outer radius, repeat for several (3 13 and 7 21)
+	--mode M          fragment, fft, taps, gather, compute, spans, gaussian, pyramid, cpu, cpu16 or cpu8, repeat for several (all)
+	--steps N         timed steps per repeat (50)
+	--warmup N        untimed steps before timing (5)
+	--repeats N       timed runs per workload (3)
+	--seed S          seed of the start state (1)
+	--out FILE        results (benchmark.json)
+	--baseline FILE   results of an earlier run to compare against
+	--tolerance F     slowdown that counts as a regression, 0.1 = 10% fewer steps/s (0.1)
+
+*/
+
+struct Workload
+{
+	std::string mode;
+	unsigned int resX;
+	unsigned int resY;
+	float ri;
+	float ra;
+};
+
+struct Result
+{
+	std::string name;
+	Workload workload;
+	double stepsPerSecond;
+	double nsPerCell;
+	size_t stateBytes;
+	size_t peakResidentBytes;
+};
+
+struct BenchOptions
+{
+	std::vector<std::pair<unsigned int, unsigned int>> sizes;
+	std::vector<std::pair<float, float>> radii;
+	std::vector<std::string> modes;
+	unsigned int steps = 50;
+	unsigned int warmup = 5;
+	unsigned int repeats = 3;
+	unsigned int seed = 1;
+	std::string out = "benchmark.json";
+	std::string baseline;
+	double tolerance = 0.1;
+};
+
+static const std::pair<const char*, Simulation::StepMode> stepModes[] =
+{
+	{ "fragment", Simulation::StepMode::Fragment }, { "fft", Simulation::StepMode::FFT },
+	{ "taps", Simulation::StepMode::TapTable }, { "gather", Simulation::StepMode::Gather },
+	{ "compute", Simulation::StepMode::Compute }, { "spans", Simulation::StepMode::Spans },
+	{ "gaussian", Simulation::StepMode::Gaussian }, { "pyramid", Simulation::StepMode::Pyramid },
+};
+
+static size_t PeakResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return size_t(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// the float CpuEngine and the fixed point QuantizedEngine with 16 and 8 bit cells
+static bool IsCpuMode(const std::string& mode)
+{
+	return mode == "cpu" || mode == "cpu16" || mode == "cpu8";
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--size" && i + 2 < argc)
+		{
+			unsigned int x = std::atoi(argv[++i]);
+			unsigned int y = std::atoi(argv[++i]);
+			options.sizes.push_back({ x, y });
+		}
+		else if (arg == "--radius" && i + 2 < argc)
+		{
+			float ri = (float)std::atof(argv[++i]);
+			float ra = (float)std::atof(argv[++i]);
+			options.radii.push_back({ ri, ra });
+		}
+		else if (arg == "--mode" && hasValue)
+		{
+			std::string mode = argv[++i];
+			bool known = IsCpuMode(mode) || std::any_of(std::begin(stepModes), std::end(stepModes), [&mode](const auto& m) { return mode == m.first; });
+			if (!known)
+			{
+				std::cout << "Unknown step mode " << mode << std::endl;
+				return false;
+			}
+			options.modes.push_back(mode);
+		}
+		else if (arg == "--steps" && hasValue) options.steps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--warmup" && hasValue) options.warmup = std::atoi(argv[++i]);
+		else if (arg == "--repeats" && hasValue) options.repeats = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--seed" && hasValue) options.seed = std::atoi(argv[++i]);
+		else if (arg == "--out" && hasValue) options.out = argv[++i];
+		else if (arg == "--baseline" && hasValue) options.baseline = argv[++i];
+		else if (arg == "--tolerance" && hasValue) options.tolerance = std::atof(argv[++i]);
+		else
+		{
+			std::cout << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+	}
+
+	if (options.sizes.empty()) options.sizes = { { 256, 256 }, { 512, 512 }, { 1280, 720 } };
+	if (options.radii.empty()) options.radii = { { 3.0f, 13.0f }, { 7.0f, 21.0f } };
+	if (options.modes.empty())
+	{
+		for (const auto& mode : stepModes) options.modes.push_back(mode.first);
+		options.modes.push_back("cpu");
+		options.modes.push_back("cpu16");
+		options.modes.push_back("cpu8");
+	}
+
+	return true;
+}
+
+static std::string Name(const Workload& workload)
+{
+	std::ostringstream name;
+	name << workload.mode << '/' << workload.resX << 'x' << workload.resY << "/ri" << workload.ri << "_ra" << workload.ra;
+	return name.str();
+}
+
+static double Median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static Result Finish(const Workload& workload, const BenchOptions& options, std::vector<double> seconds, size_t stateBytes)
+{
+	double median = Median(seconds);
+
+	Result result;
+	result.name = Name(workload);
+	result.workload = workload;
+	result.stepsPerSecond = options.steps / median;
+	result.nsPerCell = median * 1e9 / (double(options.steps) * workload.resX * workload.resY);
+	result.stateBytes = stateBytes;
+	result.peakResidentBytes = PeakResidentBytes();
+
+	std::cout << result.name << ": " << result.stepsPerSecond << " steps/s, " << result.nsPerCell << " ns/cell" << std::endl;
+
+	return result;
+}
+
+static void RunGpu(const BenchOptions& options, unsigned int resX, unsigned int resY, std::vector<Result>& results, std::string& renderer)
+{
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", resX, resY, resX, resY, true };
+	sim.Init();
+
+	renderer = (const char*)glGetString(GL_RENDERER);
+
+	for (const auto& [ri, ra] : options.radii)
+	{
+		for (const auto& [name, stepMode] : stepModes)
+		{
+			if (std::find(options.modes.begin(), options.modes.end(), name) == options.modes.end()) continue;
+
+			Workload workload{ name, resX, resY, ri, ra };
+
+			Uniforms uniforms;
+			uniforms.ri = ri;
+			uniforms.ra = ra;
+
+			sim.SetUniforms(uniforms);
+
+			// the fallback is the fragment shader, its timings would be recorded under the wrong mode
+			if (!sim.Supports(stepMode))
+			{
+				std::cout << name << ": skipped, not supported by " << (const char*)glGetString(GL_VERSION) << " at ra " << ra << std::endl;
+				continue;
+			}
+
+			sim.SetStepMode(stepMode);
+			sim.Seed(options.seed);
+
+			// also builds the tables, spectra and shader variants of the mode
+			if (options.warmup > 0) sim.Run(options.warmup);
+
+			std::vector<double> seconds;
+			for (unsigned int i = 0; i < options.repeats; i++) seconds.push_back(sim.Run(options.steps));
+
+			// two R32F state textures, the default format
+			results.push_back(Finish(workload, options, seconds, size_t(resX) * resY * sizeof(float) * 2));
+		}
+	}
+}
+
+template<typename Engine, typename Cell>
+static void RunCpu(const char* mode, const BenchOptions& options, unsigned int resX, unsigned int resY, std::vector<Result>& results)
+{
+	Engine engine{ resX, resY };
+
+	for (const auto& [ri, ra] : options.radii)
+	{
+		Workload workload{ mode, resX, resY, ri, ra };
+
+		Uniforms uniforms;
+		uniforms.ri = ri;
+		uniforms.ra = ra;
+
+		engine.Seed(options.seed, ra);
+		for (unsigned int i = 0; i < options.warmup; i++) engine.Step(uniforms);
+
+		std::vector<double> seconds;
+		for (unsigned int i = 0; i < options.repeats; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (unsigned int k = 0; k < options.steps; k++) engine.Step(uniforms);
+			seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		// current and next grid with their wrapped borders
+		size_t halo = (size_t)std::ceil(ra);
+		results.push_back(Finish(workload, options, seconds, (resX + 2 * halo) * (resY + 2 * halo) * sizeof(Cell) * 2));
+	}
+}
+
+// renderer strings are free text from the driver
+static std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char code[7];
+			std::snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+			escaped += code;
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+
+	return escaped;
+}
+
+static bool WriteResults(const std::string& path, const std::string& renderer, const std::vector<Result>& results)
+{
+	std::ofstream file{ path };
+	if (!file) return false;
+
+	file << "{\n\t\"renderer\": \"" << EscapeJson(renderer) << "\",\n\t\"instructionSet\": \"" << CpuEngine::GetInstructionSet() << "\",\n\t\"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		file << "\t\t{ \"name\": \"" << r.name << "\", \"mode\": \"" << r.workload.mode
+			<< "\", \"resX\": " << r.workload.resX << ", \"resY\": " << r.workload.resY
+			<< ", \"ri\": " << r.workload.ri << ", \"ra\": " << r.workload.ra
+			<< ", \"stepsPerSecond\": " << r.stepsPerSecond << ", \"nsPerCell\": " << r.nsPerCell
+			<< ", \"stateBytes\": " << r.stateBytes << ", \"peakResidentBytes\": " << r.peakResidentBytes
+			<< " }" << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	file << "\t]\n}\n";
+
+	return (bool)file;
+}
+
+// reads back what WriteResults wrote, one result per line, not a general JSON parser
+static std::map<std::string, double> ReadBaseline(const std::string& path)
+{
+	std::map<std::string, double> baseline;
+
+	std::ifstream file{ path };
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		size_t name = line.find("\"name\": \"");
+		size_t steps = line.find("\"stepsPerSecond\": ");
+		if (name == std::string::npos || steps == std::string::npos) continue;
+
+		name += 9;
+		baseline[line.substr(name, line.find('"', name) - name)] = std::atof(line.c_str() + steps + 18);
+	}
+
+	return baseline;
+}
+
+static int Compare(const std::vector<Result>& results, const std::string& path, double tolerance)
+{
+	std::map<std::string, double> baseline = ReadBaseline(path);
+	if (baseline.empty())
+	{
+		std::cout << "No results in baseline " << path << std::endl;
+		return 1;
+	}
+
+	int regressions = 0;
+
+	std::cout << std::endl << "Against " << path << ':' << std::endl;
+	for (const Result& result : results)
+	{
+		auto found = baseline.find(result.name);
+		if (found == baseline.end()) continue;
+
+		double ratio = result.stepsPerSecond / found->second;
+		bool regressed = ratio < 1.0 - tolerance;
+		regressions += regressed ? 1 : 0;
+
+		std::cout << (regressed ? "REGRESSION " : "           ") << result.name << ": " << ratio << 'x' << std::endl;
+	}
+
+	std::cout << regressions << " regressions" << std::endl;
+
+	return regressions > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options)) return 1;
+
+	std::vector<Result> results;
+	std::string renderer;
+
+	bool gpu = std::any_of(options.modes.begin(), options.modes.end(), [](const std::string& mode) { return !IsCpuMode(mode); });
+	auto has = [&options](const char* mode) { return std::find(options.modes.begin(), options.modes.end(), mode) != options.modes.end(); };
+
+	try
+	{
+		for (const auto& [resX, resY] : options.sizes)
+		{
+			// no GPU context is not a reason to lose the CPU modes
+			if (gpu)
+			{
+				try
+				{
+					RunGpu(options, resX, resY, results, renderer);
+				}
+				catch (const std::exception& e)
+				{
+					std::cout << "gpu modes skipped: " << e.what() << std::endl;
+				}
+			}
+
+			if (has("cpu")) RunCpu<CpuEngine, float>("cpu", options, resX, resY, results);
+			if (has("cpu16")) RunCpu<QuantizedEngine16, std::uint16_t>("cpu16", options, resX, resY, results);
+			if (has("cpu8")) RunCpu<QuantizedEngine8, std::uint8_t>("cpu8", options, resX, resY, results);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	if (!WriteResults(options.out, renderer, results))
+	{
+		std::cout << "Cannot write " << options.out << std::endl;
+		return 1;
+	}
+
+	std::cout << "Results in " << options.out << std::endl;
+
+	return options.baseline.empty() ? 0 : Compare(results, options.baseline, options.tolerance);
+}
@@ -0,0 +1,31 @@
+#include "Simulation.h"
+#include "GLExt.h"
+
+void Simulation::ComputeEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY, GLenum stateFormat)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+	format = stateFormat;
+
+	shader = Shader{ (shaderDir + "simulation.comp").c_str() };
+
+	shader.BindUniformBlock("SimData", 0);
+
+	shader.Use();
+	shader.SetInt(INPUT_UNIFORM, 0);
+	shader.SetInt("imageOut", IMAGE_UNIT);
+	shader.SetIVec2("resolution", (int)resX, (int)resY);
+
+	initialised = true;
+}
+
+void Simulation::ComputeEngine::Step(unsigned int outTexture)
+{
+	GLExt::BindImageTexture(IMAGE_UNIT, outTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+
+	shader.Use();
+	GLExt::DispatchCompute((resX + TILE - 1) / TILE, (resY + TILE - 1) / TILE, 1);
+
+	// the next pass samples the result or renders into it
+	GLExt::MemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
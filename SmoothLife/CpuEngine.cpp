@@ -0,0 +1,128 @@
+#include "CpuEngine.h"
+#include "Trace.h"
+#include "CpuKernels.h"
+#include <stdexcept>
+
+CpuEngine::CpuEngine(unsigned int resolutionX, unsigned int resolutionY, unsigned int threads)
+	: resX{resolutionX}, resY{resolutionY}, pool{threads}
+{
+	if (resX == 0 || resY == 0) throw std::runtime_error{ "CPU engine needs a non empty grid" };
+
+	CpuKernels::Select();
+
+	Resize(0);
+}
+
+void CpuEngine::Seed(unsigned int seed, float radius)
+{
+	SetState(SeedState(resX, resY, seed, radius));
+}
+
+void CpuEngine::Step(const Uniforms& uniforms)
+{
+	Trace::Zone zone{ "CpuEngine::Step" };
+
+	if (uniforms.ri != tapsRi || uniforms.ra != tapsRa)
+	{
+		BuildTaps(uniforms.ri, uniforms.ra);
+	}
+
+	unsigned int tilesX = (resX + TILE - 1) / TILE;
+	unsigned int tilesY = (resY + TILE - 1) / TILE;
+
+	CpuKernels::Rules rules{ uniforms.dt, uniforms.alpha_n, uniforms.alpha_m, uniforms.b1, uniforms.b2, uniforms.d1, uniforms.d2 };
+
+	pool.Run(tilesX * tilesY, [this, &rules](unsigned int tile) { StepTile(tile, rules); });
+	pool.Run(resY + 2 * halo, [this](unsigned int row) { FillHalo(next, row); });
+
+	current.swap(next);
+}
+
+std::vector<float> CpuEngine::GetState() const
+{
+	std::vector<float> state(resX * resY);
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		std::copy_n(Cell(current, 0, y), resX, &state[y * resX]);
+	}
+
+	return state;
+}
+
+void CpuEngine::SetState(const std::vector<float>& state)
+{
+	if (state.size() != (size_t)resX * resY) throw std::runtime_error{ "State does not match the grid size" };
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		std::copy_n(&state[y * resX], resX, Cell(current, 0, y));
+	}
+
+	for (unsigned int row = 0; row < resY + 2 * halo; row++)
+	{
+		FillHalo(current, row);
+	}
+}
+
+const char* CpuEngine::GetInstructionSet()
+{
+	return CpuKernels::GetName(CpuKernels::Select());
+}
+
+void CpuEngine::BuildTaps(float ri, float ra)
+{
+	unsigned int newHalo = (unsigned int)std::ceil(ra);
+	if (newHalo != halo) Resize(newHalo);
+
+	innerTaps.clear();
+	outerTaps.clear();
+
+	for (const KernelTap& tap : BuildKernelTaps(ri, ra))
+	{
+		CpuKernels::Tap t{ (std::ptrdiff_t)tap.y * stride + tap.x, tap.weight };
+		(tap.inner ? innerTaps : outerTaps).push_back(t);
+	}
+
+	tapsRi = ri;
+	tapsRa = ra;
+}
+
+// keeps the state but changes the width of the wrapped border
+void CpuEngine::Resize(unsigned int newHalo)
+{
+	if (newHalo > resX || newHalo > resY) throw std::runtime_error{ "ra is larger than the grid" };
+
+	std::vector<float> state = current.empty() ? std::vector<float>(resX * resY, 0.0f) : GetState();
+
+	halo = newHalo;
+	stride = resX + 2 * halo;
+
+	current.assign(stride * (resY + 2 * halo), 0.0f);
+	next.assign(current.size(), 0.0f);
+
+	SetState(state);
+}
+
+void CpuEngine::StepTile(unsigned int tile, const CpuKernels::Rules& rules)
+{
+	unsigned int tilesX = (resX + TILE - 1) / TILE;
+	unsigned int x0 = (tile % tilesX) * TILE;
+	unsigned int y0 = (tile / tilesX) * TILE;
+	unsigned int width = std::min(TILE, resX - x0);
+	unsigned int height = std::min(TILE, resY - y0);
+
+	float outer[TILE];
+	float inner[TILE];
+
+	for (unsigned int y = y0; y < y0 + height; y++)
+	{
+		const float* src = Cell(current, x0, y);
+		float* dst = Cell(next, x0, y);
+
+		CpuKernels::SumTaps(src, outerTaps.data(), outerTaps.size(), outer, width);
+		CpuKernels::SumTaps(src, innerTaps.data(), innerTaps.size(), inner, width);
+
+		CpuKernels::NextStates(rules, src, outer, inner, dst, width);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Rules.h"
+#include "ThreadPool.h"
+#include "CpuKernels.h"
+#include "PaddedGrid.h"
+
+/*
+
+Native implementation of the step in shaders/simulation.frag for machines without a GPU
+
+The grid is stored with a wrapped border of ceil(ra) cells so the convolution
+reads contiguous rows without any modulo, the border is refreshed after every step.
+Tiles of the grid are spread over a thread pool and each tile sums the kernel taps
+for a run of cells at once with the widest SIMD path of the machine (see CpuKernels.h),
+the transition of the row runs on the same path.
+
+*/
+
+class CpuEngine
+{
+public:
+	// 0 threads uses every hardware thread
+	CpuEngine(unsigned int resolutionX, unsigned int resolutionY, unsigned int threads = 0);
+
+	// see SeedState() in Rules.h
+	void Seed(unsigned int seed, float radius);
+	void Step(const Uniforms& uniforms);
+
+	// row major resX * resY, row 0 is the bottom row like the textures
+	std::vector<float> GetState() const;
+	void SetState(const std::vector<float>& state);
+
+	unsigned int GetResolutionX() const { return resX; }
+	unsigned int GetResolutionY() const { return resY; }
+	unsigned int GetThreadCount() const { return pool.GetThreadCount(); }
+
+	// instruction set of the inner loops, picked at startup
+	static const char* GetInstructionSet();
+
+private:
+	static constexpr unsigned int TILE = 64;
+
+	void BuildTaps(float ri, float ra);
+	void Resize(unsigned int newHalo);
+	void StepTile(unsigned int tile, const CpuKernels::Rules& rules);
+	void FillHalo(std::vector<float>& grid, unsigned int row) const { ::FillHalo(grid.data(), resX, resY, halo, stride, 1, row); }
+
+	float* Cell(std::vector<float>& grid, unsigned int x, unsigned int y) { return &grid[(y + halo) * stride + x + halo]; }
+	const float* Cell(const std::vector<float>& grid, unsigned int x, unsigned int y) const { return &grid[(y + halo) * stride + x + halo]; }
+
+private:
+	unsigned int resX;
+	unsigned int resY;
+
+	unsigned int halo = 0;
+	unsigned int stride = 0;
+
+	std::vector<float> current;
+	std::vector<float> next;
+
+	// offsets into the padded grid
+	std::vector<CpuKernels::Tap> innerTaps;
+	std::vector<CpuKernels::Tap> outerTaps;
+	float tapsRi = -1.0f;
+	float tapsRa = -1.0f;
+
+	ThreadPool pool;
+};
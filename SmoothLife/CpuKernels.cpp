@@ -0,0 +1,293 @@
+#include "CpuKernels.h"
+#include "Rules.h"
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SMOOTHLIFE_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+CpuKernels::SumTapsProc CpuKernels::SumTaps = nullptr;
+CpuKernels::SumLaneTapsProc CpuKernels::SumLaneTaps = nullptr;
+CpuKernels::SummariseProc CpuKernels::Summarise = nullptr;
+CpuKernels::SumTapsU8Proc CpuKernels::SumTapsU8 = nullptr;
+CpuKernels::SumTapsU16Proc CpuKernels::SumTapsU16 = nullptr;
+CpuKernels::NextStatesProc CpuKernels::NextStates = nullptr;
+CpuKernels::NextLaneStatesProc CpuKernels::NextLaneStates = nullptr;
+
+namespace
+{
+	void SumTapsScalar(const float* base, const CpuKernels::Tap* taps, size_t count, float* out, unsigned int n)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			float a = 0.0f;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	void SumLaneTapsScalar(const float* base, const std::ptrdiff_t* offsets, const float* weights, size_t count, float* out, unsigned int cells)
+	{
+		const unsigned int LANES = CpuKernels::LANES;
+
+		for (unsigned int c = 0; c < cells; c++)
+		{
+			for (unsigned int l = 0; l < LANES; l++)
+			{
+				float a = 0.0f;
+
+				for (size_t t = 0; t < count; t++)
+				{
+					a += weights[t * LANES + l] * base[offsets[t] + c * LANES + l];
+				}
+
+				out[c * LANES + l] = a;
+			}
+		}
+	}
+
+	CpuKernels::Summary SummariseScalar(const float* cells, size_t n)
+	{
+		CpuKernels::Summary summary;
+		summary.min = cells[0];
+		summary.max = cells[0];
+
+		for (size_t i = 0; i < n; i++)
+		{
+			summary.sum += cells[i];
+			summary.min = std::min(summary.min, cells[i]);
+			summary.max = std::max(summary.max, cells[i]);
+		}
+
+		return summary;
+	}
+
+	template<typename Cell>
+	void SumIntTapsScalar(const Cell* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			std::int32_t a = 0;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * (std::int32_t)base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// the reference the vector paths approximate, this file is built for the baseline so Rules.h is safe here
+	void NextStatesScalar(const CpuKernels::Rules& rules, const float* v, const float* n, const float* m, float* out, unsigned int count)
+	{
+		Uniforms uniforms;
+		uniforms.dt = rules.dt;
+		uniforms.alpha_n = rules.alpha_n;
+		uniforms.alpha_m = rules.alpha_m;
+		uniforms.b1 = rules.b1;
+		uniforms.b2 = rules.b2;
+		uniforms.d1 = rules.d1;
+		uniforms.d2 = rules.d2;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			out[i] = NextState(uniforms, v[i], n[i], m[i]);
+		}
+	}
+
+	void NextLaneStatesScalar(const CpuKernels::LaneRules& rules, const float* v, const float* n, const float* m, float* out, unsigned int cells)
+	{
+		const unsigned int LANES = CpuKernels::LANES;
+
+		Uniforms uniforms[LANES];
+		for (unsigned int l = 0; l < LANES; l++)
+		{
+			uniforms[l].dt = rules.dt[l];
+			uniforms[l].alpha_n = rules.alpha_n[l];
+			uniforms[l].alpha_m = rules.alpha_m[l];
+			uniforms[l].b1 = rules.b1[l];
+			uniforms[l].b2 = rules.b2[l];
+			uniforms[l].d1 = rules.d1[l];
+			uniforms[l].d2 = rules.d2[l];
+		}
+
+		for (unsigned int i = 0; i < cells * LANES; i++)
+		{
+			out[i] = NextState(uniforms[i % LANES], v[i], n[i], m[i]);
+		}
+	}
+
+#if defined(SMOOTHLIFE_X86)
+	void Cpuid(int leaf, int subleaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		__cpuidex((int*)regs, leaf, subleaf);
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	// which register files the OS saves on a context switch, only valid with OSXSAVE
+	unsigned long long Xgetbv()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+#endif
+
+	std::string ReadOverride()
+	{
+		std::string value;
+
+#if defined(_MSC_VER)
+		char* buffer = nullptr;
+		size_t length = 0;
+		if (_dupenv_s(&buffer, &length, "SMOOTHLIFE_ISA") == 0 && buffer != nullptr)
+		{
+			value = buffer;
+			std::free(buffer);
+		}
+#else
+		const char* buffer = std::getenv("SMOOTHLIFE_ISA");
+		if (buffer != nullptr) value = buffer;
+#endif
+
+		std::transform(value.begin(), value.end(), value.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		return value;
+	}
+}
+
+// the table is only looked at once the CPU is known to run it
+bool CpuKernels::IsSupported(Isa isa)
+{
+	if (isa == Isa::Scalar) return true;
+
+#if defined(SMOOTHLIFE_X86)
+	unsigned int leaf0[4];
+	Cpuid(0, 0, leaf0);
+	unsigned int maxLeaf = leaf0[0];
+
+	unsigned int leaf1[4];
+	Cpuid(1, 0, leaf1);
+
+	unsigned int leaf7[4] = {};
+	if (maxLeaf >= 7) Cpuid(7, 0, leaf7);
+
+	bool sse2 = (leaf1[3] >> 26) & 1;
+	bool osxsave = (leaf1[2] >> 27) & 1;
+	unsigned long long xcr0 = osxsave ? Xgetbv() : 0;
+
+	// XMM and YMM state, then opmask and both halves of ZMM
+	bool osAvx = (xcr0 & 0x6) == 0x6;
+	bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+	bool avx2 = osAvx && ((leaf1[2] >> 28) & 1) && ((leaf1[2] >> 12) & 1) && ((leaf7[1] >> 5) & 1);
+	bool avx512 = avx2 && osAvx512 && ((leaf7[1] >> 16) & 1) && ((leaf7[1] >> 30) & 1) && ((leaf7[1] >> 31) & 1);
+
+	bool cpu = false;
+
+	switch (isa)
+	{
+	case Isa::SSE2: cpu = sse2; break;
+	case Isa::AVX2: cpu = avx2; break;
+	case Isa::AVX512: cpu = avx512; break;
+	default: break;
+	}
+
+	return cpu && GetTable(isa) != nullptr;
+#else
+	return false;
+#endif
+}
+
+const char* CpuKernels::GetName(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::SSE2: return "SSE2";
+	case Isa::AVX2: return "AVX2";
+	case Isa::AVX512: return "AVX-512";
+	default: return "scalar";
+	}
+}
+
+CpuKernels::Isa CpuKernels::Select()
+{
+	static std::once_flag once;
+	static Isa selected = Isa::Scalar;
+
+	std::call_once(once, []()
+	{
+		for (int i = (int)Isa::Count - 1; i >= 0; i--)
+		{
+			if (IsSupported((Isa)i))
+			{
+				selected = (Isa)i;
+				break;
+			}
+		}
+
+		std::string forced = ReadOverride();
+		if (!forced.empty())
+		{
+			const std::pair<const char*, Isa> names[] = { { "scalar", Isa::Scalar }, { "sse2", Isa::SSE2 }, { "avx2", Isa::AVX2 }, { "avx512", Isa::AVX512 } };
+			auto name = std::find_if(std::begin(names), std::end(names), [&forced](const auto& name) { return forced == name.first; });
+
+			if (name == std::end(names))
+				std::cout << "Unknown SMOOTHLIFE_ISA " << forced << ", using " << GetName(selected) << std::endl;
+			else if (!IsSupported(name->second))
+				std::cout << "SMOOTHLIFE_ISA " << forced << " is not supported here, using " << GetName(selected) << std::endl;
+			else
+				selected = name->second;
+		}
+
+		const Table* table = GetTable(selected);
+		SumTaps = table->sumTaps;
+		SumLaneTaps = table->sumLaneTaps;
+		Summarise = table->summarise;
+		SumTapsU8 = table->sumTapsU8;
+		SumTapsU16 = table->sumTapsU16;
+		NextStates = table->nextStates;
+		NextLaneStates = table->nextLaneStates;
+	});
+
+	return selected;
+}
+
+const CpuKernels::Table* CpuKernels::GetTable(Isa isa)
+{
+	switch (isa)
+	{
+	case Isa::SSE2: return SSE2Table();
+	case Isa::AVX2: return AVX2Table();
+	case Isa::AVX512: return AVX512Table();
+	default: return ScalarTable();
+	}
+}
+
+const CpuKernels::Table* CpuKernels::ScalarTable()
+{
+	static const Table table{ SumTapsScalar, SumLaneTapsScalar, SummariseScalar, SumIntTapsScalar<std::uint8_t>, SumIntTapsScalar<std::uint16_t>, NextStatesScalar, NextLaneStatesScalar };
+	return &table;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+
+Inner loops of the native engines, built once per instruction set and picked at runtime,
+so one binary runs the widest path every machine supports.
+
+Every path lives in its own translation unit (CpuKernels<Isa>.cpp) compiled for that
+instruction set, only the kernels themselves go there so no inline function of a shared
+header is ever built with instructions the machine may not have.
+Select() checks cpuid and the registers the OS saves, the environment variable
+SMOOTHLIFE_ISA (scalar, sse2, avx2 or avx512) forces a path for A/B runs.
+
+The paths with FMA round differently from the others, results agree to float precision only.
+The integer kernels are exact on every path. NextStates and NextLaneStates use std::exp on the scalar
+path and a polynomial exp on the others, the new states agree to 2e-6.
+
+*/
+
+struct CpuKernels
+{
+	enum class Isa
+	{
+		Scalar,
+		SSE2,
+		AVX2,   // with FMA
+		AVX512, // AVX-512F, BW and VL
+		Count,
+	};
+
+	// universes per cell of SumLaneTaps
+	static constexpr unsigned int LANES = 8;
+
+	struct Tap
+	{
+		std::ptrdiff_t offset;
+		float weight;
+	};
+
+	// weights of the fixed point kernels, scaled so a sum fits into 32 bits
+	struct IntTap
+	{
+		std::ptrdiff_t offset;
+		std::int16_t weight;
+	};
+
+	struct Summary
+	{
+		double sum = 0.0;
+		float min = 0.0f;
+		float max = 0.0f;
+	};
+
+	// the fields of Uniforms that NextState() in Rules.h reads, the kernels do not include Rules.h
+	struct Rules
+	{
+		float dt;
+		float alpha_n;
+		float alpha_m;
+		float b1;
+		float b2;
+		float d1;
+		float d2;
+	};
+
+	// the same fields once per universe of a SumLaneTaps cell
+	struct LaneRules
+	{
+		float dt[LANES];
+		float alpha_n[LANES];
+		float alpha_m[LANES];
+		float b1[LANES];
+		float b2[LANES];
+		float d1[LANES];
+		float d2[LANES];
+	};
+
+	// out[i] = sum of taps[t].weight * base[taps[t].offset + i] for i in [0, n)
+	typedef void (*SumTapsProc)(const float* base, const Tap* taps, size_t count, float* out, unsigned int n);
+	// LANES floats per cell, one weight per lane and tap
+	// out[c * LANES + l] = sum of weights[t * LANES + l] * base[offsets[t] + c * LANES + l] for c in [0, cells)
+	typedef void (*SumLaneTapsProc)(const float* base, const std::ptrdiff_t* offsets, const float* weights, size_t count, float* out, unsigned int cells);
+	// sum, min and max of n cells, n > 0
+	typedef Summary (*SummariseProc)(const float* cells, size_t n);
+	// fixed point SumTaps, 16 bit products summed in 32 bits, two taps per multiply add (pmaddwd)
+	// count has to be even, cells have to be below 32768
+	typedef void (*SumTapsU8Proc)(const std::uint8_t* base, const IntTap* taps, size_t count, std::int32_t* out, unsigned int n);
+	typedef void (*SumTapsU16Proc)(const std::uint16_t* base, const IntTap* taps, size_t count, std::int32_t* out, unsigned int n);
+	// out[i] = NextState() of the cell v[i] with the outer sum n[i] and the inner sum m[i] for i in [0, count)
+	typedef void (*NextStatesProc)(const Rules& rules, const float* v, const float* n, const float* m, float* out, unsigned int count);
+	// NextStates with LANES floats per cell like SumLaneTaps, lane l follows the rules of universe l
+	typedef void (*NextLaneStatesProc)(const LaneRules& rules, const float* v, const float* n, const float* m, float* out, unsigned int cells);
+
+	struct Table
+	{
+		SumTapsProc sumTaps;
+		SumLaneTapsProc sumLaneTaps;
+		SummariseProc summarise;
+		SumTapsU8Proc sumTapsU8;
+		SumTapsU16Proc sumTapsU16;
+		NextStatesProc nextStates;
+		NextLaneStatesProc nextLaneStates;
+	};
+
+	// the kernels of the selected path, null until the first Select
+	static SumTapsProc SumTaps;
+	static SumLaneTapsProc SumLaneTaps;
+	static SummariseProc Summarise;
+	static SumTapsU8Proc SumTapsU8;
+	static SumTapsU16Proc SumTapsU16;
+	static NextStatesProc NextStates;
+	static NextLaneStatesProc NextLaneStates;
+
+	// picks the path the first time it is called and returns it on every later call
+	// prints a note when SMOOTHLIFE_ISA names a path that cannot run here
+	static Isa Select();
+
+	static bool IsSupported(Isa isa);
+	static const char* GetName(Isa isa);
+
+private:
+	// nullptr when the compiler could not build the path
+	static const Table* GetTable(Isa isa);
+
+	static const Table* ScalarTable();
+	static const Table* SSE2Table();
+	static const Table* AVX2Table();
+	static const Table* AVX512Table();
+};
@@ -0,0 +1,424 @@
+#include "CpuKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// after the includes and only around the kernels, nothing else is compiled for AVX2
+// MSVC builds this file with /arch:AVX2 (see the project file)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace
+{
+	const unsigned int LANES = CpuKernels::LANES;
+
+	void SumTapsAVX2(const float* base, const CpuKernels::Tap* taps, size_t count, float* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 32 <= n; i += 32)
+		{
+			__m256 a0 = _mm256_setzero_ps();
+			__m256 a1 = _mm256_setzero_ps();
+			__m256 a2 = _mm256_setzero_ps();
+			__m256 a3 = _mm256_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + taps[t].offset + i;
+				__m256 w = _mm256_set1_ps(taps[t].weight);
+
+				a0 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p), a0);
+				a1 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 8), a1);
+				a2 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 16), a2);
+				a3 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 24), a3);
+			}
+
+			_mm256_storeu_ps(out + i, a0);
+			_mm256_storeu_ps(out + i + 8, a1);
+			_mm256_storeu_ps(out + i + 16, a2);
+			_mm256_storeu_ps(out + i + 24, a3);
+		}
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 a = _mm256_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm256_fmadd_ps(_mm256_set1_ps(taps[t].weight), _mm256_loadu_ps(base + taps[t].offset + i), a);
+			}
+
+			_mm256_storeu_ps(out + i, a);
+		}
+
+		for (; i < n; i++)
+		{
+			float a = 0.0f;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// one register per cell, four cells share every weight load
+	void SumLaneTapsAVX2(const float* base, const std::ptrdiff_t* offsets, const float* weights, size_t count, float* out, unsigned int cells)
+	{
+		unsigned int c = 0;
+
+		for (; c + 4 <= cells; c += 4)
+		{
+			__m256 a0 = _mm256_setzero_ps();
+			__m256 a1 = _mm256_setzero_ps();
+			__m256 a2 = _mm256_setzero_ps();
+			__m256 a3 = _mm256_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + offsets[t] + c * LANES;
+				__m256 w = _mm256_loadu_ps(weights + t * LANES);
+
+				a0 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p), a0);
+				a1 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 8), a1);
+				a2 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 16), a2);
+				a3 = _mm256_fmadd_ps(w, _mm256_loadu_ps(p + 24), a3);
+			}
+
+			_mm256_storeu_ps(out + c * LANES, a0);
+			_mm256_storeu_ps(out + c * LANES + 8, a1);
+			_mm256_storeu_ps(out + c * LANES + 16, a2);
+			_mm256_storeu_ps(out + c * LANES + 24, a3);
+		}
+
+		for (; c < cells; c++)
+		{
+			__m256 a = _mm256_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm256_fmadd_ps(_mm256_loadu_ps(weights + t * LANES), _mm256_loadu_ps(base + offsets[t] + c * LANES), a);
+			}
+
+			_mm256_storeu_ps(out + c * LANES, a);
+		}
+	}
+
+	// float partial sums over blocks short enough to keep their precision, the blocks add up in double
+	CpuKernels::Summary SummariseAVX2(const float* cells, size_t n)
+	{
+		const size_t BLOCK = 8192;
+
+		CpuKernels::Summary summary;
+		__m256 low = _mm256_set1_ps(cells[0]);
+		__m256 high = low;
+
+		size_t i = 0;
+		for (; i + 8 <= n;)
+		{
+			size_t end = i + BLOCK < n ? i + BLOCK : n;
+			__m256 sum = _mm256_setzero_ps();
+
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256 v = _mm256_loadu_ps(cells + i);
+				sum = _mm256_add_ps(sum, v);
+				low = _mm256_min_ps(low, v);
+				high = _mm256_max_ps(high, v);
+			}
+
+			float lanes[8];
+			_mm256_storeu_ps(lanes, sum);
+			for (float lane : lanes) summary.sum += lane;
+		}
+
+		float lows[8];
+		float highs[8];
+		_mm256_storeu_ps(lows, low);
+		_mm256_storeu_ps(highs, high);
+
+		summary.min = lows[0];
+		summary.max = highs[0];
+		for (int k = 1; k < 8; k++)
+		{
+			summary.min = lows[k] < summary.min ? lows[k] : summary.min;
+			summary.max = highs[k] > summary.max ? highs[k] : summary.max;
+		}
+
+		for (; i < n; i++)
+		{
+			summary.sum += cells[i];
+			summary.min = cells[i] < summary.min ? cells[i] : summary.min;
+			summary.max = cells[i] > summary.max ? cells[i] : summary.max;
+		}
+
+		return summary;
+	}
+
+	// the weights of taps t and t + 1 in the low and high half of every 32 bit lane
+	__m256i PairWeights(const CpuKernels::IntTap* taps, size_t t)
+	{
+		return _mm256_set1_epi32((int)((std::uint16_t)taps[t].weight | ((std::uint32_t)(std::uint16_t)taps[t + 1].weight << 16)));
+	}
+
+	// zero extending after the byte interleave keeps the cells in order
+	void SumTapsU8AVX2(const std::uint8_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 32 <= n; i += 32)
+		{
+			__m256i a0 = _mm256_setzero_si256();
+			__m256i a1 = _mm256_setzero_si256();
+			__m256i a2 = _mm256_setzero_si256();
+			__m256i a3 = _mm256_setzero_si256();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m256i w = PairWeights(taps, t);
+				const std::uint8_t* p = base + taps[t].offset + i;
+				const std::uint8_t* q = base + taps[t + 1].offset + i;
+
+				__m128i x0 = _mm_loadu_si128((const __m128i*)p);
+				__m128i x1 = _mm_loadu_si128((const __m128i*)(p + 16));
+				__m128i y0 = _mm_loadu_si128((const __m128i*)q);
+				__m128i y1 = _mm_loadu_si128((const __m128i*)(q + 16));
+
+				a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(x0, y0)), w));
+				a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(x0, y0)), w));
+				a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(x1, y1)), w));
+				a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpackhi_epi8(x1, y1)), w));
+			}
+
+			_mm256_storeu_si256((__m256i*)(out + i), a0);
+			_mm256_storeu_si256((__m256i*)(out + i + 8), a1);
+			_mm256_storeu_si256((__m256i*)(out + i + 16), a2);
+			_mm256_storeu_si256((__m256i*)(out + i + 24), a3);
+		}
+
+		// the narrow last tile of a row
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256i a = _mm256_setzero_si256();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m128i x = _mm_loadl_epi64((const __m128i*)(base + taps[t].offset + i));
+				__m128i y = _mm_loadl_epi64((const __m128i*)(base + taps[t + 1].offset + i));
+
+				a = _mm256_add_epi32(a, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(x, y)), PairWeights(taps, t)));
+			}
+
+			_mm256_storeu_si256((__m256i*)(out + i), a);
+		}
+
+		for (; i < n; i++)
+		{
+			std::int32_t a = 0;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * (std::int32_t)base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// the 256 bit unpacks work within each 128 bit half, so the sums come out as cells
+	// 0-3 8-11 and 4-7 12-15 and are put back in order when stored
+	void SumTapsU16AVX2(const std::uint16_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 32 <= n; i += 32)
+		{
+			__m256i a0 = _mm256_setzero_si256();
+			__m256i a1 = _mm256_setzero_si256();
+			__m256i a2 = _mm256_setzero_si256();
+			__m256i a3 = _mm256_setzero_si256();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m256i w = PairWeights(taps, t);
+				const std::uint16_t* p = base + taps[t].offset + i;
+				const std::uint16_t* q = base + taps[t + 1].offset + i;
+
+				__m256i x0 = _mm256_loadu_si256((const __m256i*)p);
+				__m256i x1 = _mm256_loadu_si256((const __m256i*)(p + 16));
+				__m256i y0 = _mm256_loadu_si256((const __m256i*)q);
+				__m256i y1 = _mm256_loadu_si256((const __m256i*)(q + 16));
+
+				a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(_mm256_unpacklo_epi16(x0, y0), w));
+				a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(_mm256_unpackhi_epi16(x0, y0), w));
+				a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(_mm256_unpacklo_epi16(x1, y1), w));
+				a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(_mm256_unpackhi_epi16(x1, y1), w));
+			}
+
+			_mm256_storeu_si256((__m256i*)(out + i), _mm256_permute2x128_si256(a0, a1, 0x20));
+			_mm256_storeu_si256((__m256i*)(out + i + 8), _mm256_permute2x128_si256(a0, a1, 0x31));
+			_mm256_storeu_si256((__m256i*)(out + i + 16), _mm256_permute2x128_si256(a2, a3, 0x20));
+			_mm256_storeu_si256((__m256i*)(out + i + 24), _mm256_permute2x128_si256(a2, a3, 0x31));
+		}
+
+		// the narrow last tile of a row, cells 0-3 go to the low half and 4-7 to the high half
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256i a = _mm256_setzero_si256();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m128i x = _mm_loadu_si128((const __m128i*)(base + taps[t].offset + i));
+				__m128i y = _mm_loadu_si128((const __m128i*)(base + taps[t + 1].offset + i));
+				__m256i pairs = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(x, y)), _mm_unpackhi_epi16(x, y), 1);
+
+				a = _mm256_add_epi32(a, _mm256_madd_epi16(pairs, PairWeights(taps, t)));
+			}
+
+			_mm256_storeu_si256((__m256i*)(out + i), a);
+		}
+
+		for (; i < n; i++)
+		{
+			std::int32_t a = 0;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * (std::int32_t)base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// 1 / (1 + exp(-z)) with the expf polynomial of Cephes, 2^k goes straight into the exponent bits
+	__m256 SigmoidAVX2(__m256 z)
+	{
+		__m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_setzero_ps(), z), _mm256_set1_ps(-87.0f)), _mm256_set1_ps(87.0f));
+
+		// exp(x) = 2^k exp(r) with |r| <= ln 2 / 2
+		__m256 k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(0.693359375f), x);
+		r = _mm256_fnmadd_ps(k, _mm256_set1_ps(-2.12194440e-4f), r);
+
+		__m256 p = _mm256_set1_ps(1.9875691500e-4f);
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+		p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+		p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+		__m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23);
+		__m256 e = _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+
+		return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+	}
+
+	// the rules of eight cells, the same in every lane for one universe or one universe per lane
+	struct RulesAVX2
+	{
+		__m256 dt;
+		__m256 b1;
+		__m256 b2;
+		__m256 d1b1; // d1 - b1
+		__m256 d2b2; // d2 - b2
+		__m256 slopeN; // 4 / alpha_n
+		__m256 slopeM; // 4 / alpha_m
+	};
+
+	RulesAVX2 LoadRules(const CpuKernels::LaneRules& rules)
+	{
+		__m256 b1 = _mm256_loadu_ps(rules.b1);
+		__m256 b2 = _mm256_loadu_ps(rules.b2);
+		__m256 four = _mm256_set1_ps(4.0f);
+
+		return { _mm256_loadu_ps(rules.dt), b1, b2, _mm256_sub_ps(_mm256_loadu_ps(rules.d1), b1), _mm256_sub_ps(_mm256_loadu_ps(rules.d2), b2), _mm256_div_ps(four, _mm256_loadu_ps(rules.alpha_n)), _mm256_div_ps(four, _mm256_loadu_ps(rules.alpha_m)) };
+	}
+
+	RulesAVX2 BroadcastRules(const CpuKernels::Rules& rules)
+	{
+		return { _mm256_set1_ps(rules.dt), _mm256_set1_ps(rules.b1), _mm256_set1_ps(rules.b2), _mm256_set1_ps(rules.d1 - rules.b1), _mm256_set1_ps(rules.d2 - rules.b2), _mm256_set1_ps(4.0f / rules.alpha_n), _mm256_set1_ps(4.0f / rules.alpha_m) };
+	}
+
+	// the steps of NextState() in Rules.h for eight cells
+	__m256 NextStateAVX2(const RulesAVX2& rules, __m256 v, __m256 n, __m256 m)
+	{
+		__m256 s = SigmoidAVX2(_mm256_mul_ps(_mm256_sub_ps(m, _mm256_set1_ps(0.5f)), rules.slopeM));
+		__m256 a = _mm256_fmadd_ps(rules.d1b1, s, rules.b1);
+		__m256 b = _mm256_fmadd_ps(rules.d2b2, s, rules.b2);
+
+		__m256 t = _mm256_mul_ps(SigmoidAVX2(_mm256_mul_ps(_mm256_sub_ps(n, a), rules.slopeN)), _mm256_sub_ps(_mm256_set1_ps(1.0f), SigmoidAVX2(_mm256_mul_ps(_mm256_sub_ps(n, b), rules.slopeN))));
+
+		__m256 next = _mm256_fmadd_ps(rules.dt, _mm256_sub_ps(_mm256_add_ps(t, t), _mm256_set1_ps(1.0f)), v);
+		return _mm256_min_ps(_mm256_max_ps(next, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	}
+
+	void NextStatesAVX2(const CpuKernels::Rules& rules, const float* v, const float* n, const float* m, float* out, unsigned int count)
+	{
+		RulesAVX2 vector = BroadcastRules(rules);
+		unsigned int i = 0;
+
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(out + i, NextStateAVX2(vector, _mm256_loadu_ps(v + i), _mm256_loadu_ps(n + i), _mm256_loadu_ps(m + i)));
+		}
+
+		// the last few cells of a row through a padded copy
+		if (i < count)
+		{
+			float cells[3][8] = {};
+			float next[8];
+
+			for (unsigned int j = 0; j < count - i; j++)
+			{
+				cells[0][j] = v[i + j];
+				cells[1][j] = n[i + j];
+				cells[2][j] = m[i + j];
+			}
+
+			_mm256_storeu_ps(next, NextStateAVX2(vector, _mm256_loadu_ps(cells[0]), _mm256_loadu_ps(cells[1]), _mm256_loadu_ps(cells[2])));
+
+			for (unsigned int j = 0; j < count - i; j++) out[i + j] = next[j];
+		}
+	}
+
+	// one register per cell, lane l keeps the rules of universe l
+	void NextLaneStatesAVX2(const CpuKernels::LaneRules& rules, const float* v, const float* n, const float* m, float* out, unsigned int cells)
+	{
+		RulesAVX2 vector = LoadRules(rules);
+
+		for (unsigned int i = 0; i < cells * LANES; i += LANES)
+		{
+			_mm256_storeu_ps(out + i, NextStateAVX2(vector, _mm256_loadu_ps(v + i), _mm256_loadu_ps(n + i), _mm256_loadu_ps(m + i)));
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+const CpuKernels::Table* CpuKernels::AVX2Table()
+{
+	static const Table table{ SumTapsAVX2, SumLaneTapsAVX2, SummariseAVX2, SumTapsU8AVX2, SumTapsU16AVX2, NextStatesAVX2, NextLaneStatesAVX2 };
+	return &table;
+}
+
+#else
+
+const CpuKernels::Table* CpuKernels::AVX2Table()
+{
+	return nullptr;
+}
+
+#endif
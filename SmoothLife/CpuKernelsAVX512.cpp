@@ -0,0 +1,440 @@
+#include "CpuKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// after the includes and only around the kernels, nothing else is compiled for AVX-512
+// MSVC builds this file with /arch:AVX512 (see the project file)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw,avx512vl,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx2,fma")
+#endif
+
+namespace
+{
+	const unsigned int LANES = CpuKernels::LANES;
+
+	void SumTapsAVX512(const float* base, const CpuKernels::Tap* taps, size_t count, float* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 64 <= n; i += 64)
+		{
+			__m512 a0 = _mm512_setzero_ps();
+			__m512 a1 = _mm512_setzero_ps();
+			__m512 a2 = _mm512_setzero_ps();
+			__m512 a3 = _mm512_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + taps[t].offset + i;
+				__m512 w = _mm512_set1_ps(taps[t].weight);
+
+				a0 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p), a0);
+				a1 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 16), a1);
+				a2 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 32), a2);
+				a3 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 48), a3);
+			}
+
+			_mm512_storeu_ps(out + i, a0);
+			_mm512_storeu_ps(out + i + 16, a1);
+			_mm512_storeu_ps(out + i + 32, a2);
+			_mm512_storeu_ps(out + i + 48, a3);
+		}
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512 a = _mm512_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm512_fmadd_ps(_mm512_set1_ps(taps[t].weight), _mm512_loadu_ps(base + taps[t].offset + i), a);
+			}
+
+			_mm512_storeu_ps(out + i, a);
+		}
+
+		// the last few cells of a row with a mask instead of a scalar loop
+		if (i < n)
+		{
+			__mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+			__m512 a = _mm512_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm512_fmadd_ps(_mm512_set1_ps(taps[t].weight), _mm512_maskz_loadu_ps(mask, base + taps[t].offset + i), a);
+			}
+
+			_mm512_mask_storeu_ps(out + i, mask, a);
+		}
+	}
+
+	// the weights of the 8 lanes fill both halves of a register, so one register holds two cells
+	// four registers (eight cells) share every weight load
+	void SumLaneTapsAVX512(const float* base, const std::ptrdiff_t* offsets, const float* weights, size_t count, float* out, unsigned int cells)
+	{
+		auto weightPair = [weights](size_t t)
+		{
+			__m512 w = _mm512_castps256_ps512(_mm256_loadu_ps(weights + t * LANES));
+			return _mm512_shuffle_f32x4(w, w, _MM_SHUFFLE(1, 0, 1, 0));
+		};
+
+		unsigned int c = 0;
+
+		for (; c + 8 <= cells; c += 8)
+		{
+			__m512 a0 = _mm512_setzero_ps();
+			__m512 a1 = _mm512_setzero_ps();
+			__m512 a2 = _mm512_setzero_ps();
+			__m512 a3 = _mm512_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + offsets[t] + c * LANES;
+				__m512 w = weightPair(t);
+
+				a0 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p), a0);
+				a1 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 16), a1);
+				a2 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 32), a2);
+				a3 = _mm512_fmadd_ps(w, _mm512_loadu_ps(p + 48), a3);
+			}
+
+			_mm512_storeu_ps(out + c * LANES, a0);
+			_mm512_storeu_ps(out + c * LANES + 16, a1);
+			_mm512_storeu_ps(out + c * LANES + 32, a2);
+			_mm512_storeu_ps(out + c * LANES + 48, a3);
+		}
+
+		for (; c + 2 <= cells; c += 2)
+		{
+			__m512 a = _mm512_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm512_fmadd_ps(weightPair(t), _mm512_loadu_ps(base + offsets[t] + c * LANES), a);
+			}
+
+			_mm512_storeu_ps(out + c * LANES, a);
+		}
+
+		for (; c < cells; c++)
+		{
+			__m256 a = _mm256_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm256_fmadd_ps(_mm256_loadu_ps(weights + t * LANES), _mm256_loadu_ps(base + offsets[t] + c * LANES), a);
+			}
+
+			_mm256_storeu_ps(out + c * LANES, a);
+		}
+	}
+
+	// float partial sums over blocks short enough to keep their precision, the blocks add up in double
+	CpuKernels::Summary SummariseAVX512(const float* cells, size_t n)
+	{
+		const size_t BLOCK = 16384;
+
+		CpuKernels::Summary summary;
+		__m512 low = _mm512_set1_ps(cells[0]);
+		__m512 high = low;
+
+		size_t i = 0;
+		while (i < n)
+		{
+			size_t end = i + BLOCK < n ? i + BLOCK : n;
+			__m512 sum = _mm512_setzero_ps();
+
+			for (; i + 16 <= end; i += 16)
+			{
+				__m512 v = _mm512_loadu_ps(cells + i);
+				sum = _mm512_add_ps(sum, v);
+				low = _mm512_min_ps(low, v);
+				high = _mm512_max_ps(high, v);
+			}
+
+			if (i < end)
+			{
+				// the masked off lanes keep their old value in low and high and add 0 to the sum
+				__mmask16 mask = (__mmask16)((1u << (end - i)) - 1);
+				__m512 v = _mm512_maskz_loadu_ps(mask, cells + i);
+				sum = _mm512_add_ps(sum, v);
+				low = _mm512_mask_min_ps(low, mask, low, v);
+				high = _mm512_mask_max_ps(high, mask, high, v);
+				i = end;
+			}
+
+			summary.sum += _mm512_reduce_add_ps(sum);
+		}
+
+		summary.min = _mm512_reduce_min_ps(low);
+		summary.max = _mm512_reduce_max_ps(high);
+
+		return summary;
+	}
+
+	// the weights of taps t and t + 1 in the low and high half of every 32 bit lane
+	__m512i PairWeights(const CpuKernels::IntTap* taps, size_t t)
+	{
+		return _mm512_set1_epi32((int)((std::uint16_t)taps[t].weight | ((std::uint32_t)(std::uint16_t)taps[t + 1].weight << 16)));
+	}
+
+	// zero extending after the byte interleave keeps the cells of each 128 bit half together, the sums
+	// come out as cells 0-7 16-23 and 8-15 24-31 and are put back in order when stored
+	void SumTapsU8AVX512(const std::uint8_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		const __m512i first = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23);
+		const __m512i second = _mm512_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15, 24, 25, 26, 27, 28, 29, 30, 31);
+
+		unsigned int i = 0;
+
+		for (; i + 64 <= n; i += 64)
+		{
+			__m512i a0 = _mm512_setzero_si512();
+			__m512i a1 = _mm512_setzero_si512();
+			__m512i a2 = _mm512_setzero_si512();
+			__m512i a3 = _mm512_setzero_si512();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m512i w = PairWeights(taps, t);
+				const std::uint8_t* p = base + taps[t].offset + i;
+				const std::uint8_t* q = base + taps[t + 1].offset + i;
+
+				__m256i x0 = _mm256_loadu_si256((const __m256i*)p);
+				__m256i x1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+				__m256i y0 = _mm256_loadu_si256((const __m256i*)q);
+				__m256i y1 = _mm256_loadu_si256((const __m256i*)(q + 32));
+
+				a0 = _mm512_add_epi32(a0, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpacklo_epi8(x0, y0)), w));
+				a1 = _mm512_add_epi32(a1, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpackhi_epi8(x0, y0)), w));
+				a2 = _mm512_add_epi32(a2, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpacklo_epi8(x1, y1)), w));
+				a3 = _mm512_add_epi32(a3, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpackhi_epi8(x1, y1)), w));
+			}
+
+			_mm512_storeu_si512(out + i, _mm512_permutex2var_epi32(a0, first, a1));
+			_mm512_storeu_si512(out + i + 16, _mm512_permutex2var_epi32(a0, second, a1));
+			_mm512_storeu_si512(out + i + 32, _mm512_permutex2var_epi32(a2, first, a3));
+			_mm512_storeu_si512(out + i + 48, _mm512_permutex2var_epi32(a2, second, a3));
+		}
+
+		// the last cells of a row 32 at a time with masks instead of a scalar loop
+		for (; i < n; i += 32)
+		{
+			unsigned int left = n - i < 32 ? n - i : 32;
+			__mmask32 mask = (__mmask32)(left == 32 ? 0xFFFFFFFFu : (1u << left) - 1);
+
+			__m512i a0 = _mm512_setzero_si512();
+			__m512i a1 = _mm512_setzero_si512();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m512i w = PairWeights(taps, t);
+				__m256i x = _mm256_maskz_loadu_epi8(mask, base + taps[t].offset + i);
+				__m256i y = _mm256_maskz_loadu_epi8(mask, base + taps[t + 1].offset + i);
+
+				a0 = _mm512_add_epi32(a0, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpacklo_epi8(x, y)), w));
+				a1 = _mm512_add_epi32(a1, _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm256_unpackhi_epi8(x, y)), w));
+			}
+
+			_mm512_mask_storeu_epi32(out + i, (__mmask16)mask, _mm512_permutex2var_epi32(a0, first, a1));
+			_mm512_mask_storeu_epi32(out + i + 16, (__mmask16)(mask >> 16), _mm512_permutex2var_epi32(a0, second, a1));
+		}
+	}
+
+	// the unpacks work within each 128 bit quarter, the sums come out as cells
+	// 0-3 8-11 16-19 24-27 and 4-7 12-15 20-23 28-31 and are put back in order when stored
+	void SumTapsU16AVX512(const std::uint16_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		const __m512i first = _mm512_setr_epi32(0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23);
+		const __m512i second = _mm512_setr_epi32(8, 9, 10, 11, 24, 25, 26, 27, 12, 13, 14, 15, 28, 29, 30, 31);
+
+		unsigned int i = 0;
+
+		for (; i + 64 <= n; i += 64)
+		{
+			__m512i a0 = _mm512_setzero_si512();
+			__m512i a1 = _mm512_setzero_si512();
+			__m512i a2 = _mm512_setzero_si512();
+			__m512i a3 = _mm512_setzero_si512();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m512i w = PairWeights(taps, t);
+				const std::uint16_t* p = base + taps[t].offset + i;
+				const std::uint16_t* q = base + taps[t + 1].offset + i;
+
+				__m512i x0 = _mm512_loadu_si512(p);
+				__m512i x1 = _mm512_loadu_si512(p + 32);
+				__m512i y0 = _mm512_loadu_si512(q);
+				__m512i y1 = _mm512_loadu_si512(q + 32);
+
+				a0 = _mm512_add_epi32(a0, _mm512_madd_epi16(_mm512_unpacklo_epi16(x0, y0), w));
+				a1 = _mm512_add_epi32(a1, _mm512_madd_epi16(_mm512_unpackhi_epi16(x0, y0), w));
+				a2 = _mm512_add_epi32(a2, _mm512_madd_epi16(_mm512_unpacklo_epi16(x1, y1), w));
+				a3 = _mm512_add_epi32(a3, _mm512_madd_epi16(_mm512_unpackhi_epi16(x1, y1), w));
+			}
+
+			_mm512_storeu_si512(out + i, _mm512_permutex2var_epi32(a0, first, a1));
+			_mm512_storeu_si512(out + i + 16, _mm512_permutex2var_epi32(a0, second, a1));
+			_mm512_storeu_si512(out + i + 32, _mm512_permutex2var_epi32(a2, first, a3));
+			_mm512_storeu_si512(out + i + 48, _mm512_permutex2var_epi32(a2, second, a3));
+		}
+
+		// the last cells of a row 32 at a time with masks instead of a scalar loop
+		for (; i < n; i += 32)
+		{
+			unsigned int left = n - i < 32 ? n - i : 32;
+			__mmask32 mask = (__mmask32)(left == 32 ? 0xFFFFFFFFu : (1u << left) - 1);
+
+			__m512i a0 = _mm512_setzero_si512();
+			__m512i a1 = _mm512_setzero_si512();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m512i w = PairWeights(taps, t);
+				__m512i x = _mm512_maskz_loadu_epi16(mask, base + taps[t].offset + i);
+				__m512i y = _mm512_maskz_loadu_epi16(mask, base + taps[t + 1].offset + i);
+
+				a0 = _mm512_add_epi32(a0, _mm512_madd_epi16(_mm512_unpacklo_epi16(x, y), w));
+				a1 = _mm512_add_epi32(a1, _mm512_madd_epi16(_mm512_unpackhi_epi16(x, y), w));
+			}
+
+			_mm512_mask_storeu_epi32(out + i, (__mmask16)mask, _mm512_permutex2var_epi32(a0, first, a1));
+			_mm512_mask_storeu_epi32(out + i + 16, (__mmask16)(mask >> 16), _mm512_permutex2var_epi32(a0, second, a1));
+		}
+	}
+
+	// 1 / (1 + exp(-z)) with the expf polynomial of Cephes, scalef multiplies by 2^k
+	__m512 SigmoidAVX512(__m512 z)
+	{
+		__m512 x = _mm512_min_ps(_mm512_max_ps(_mm512_sub_ps(_mm512_setzero_ps(), z), _mm512_set1_ps(-87.0f)), _mm512_set1_ps(87.0f));
+
+		// exp(x) = 2^k exp(r) with |r| <= ln 2 / 2
+		__m512 k = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps(0.693359375f), x);
+		r = _mm512_fnmadd_ps(k, _mm512_set1_ps(-2.12194440e-4f), r);
+
+		__m512 p = _mm512_set1_ps(1.9875691500e-4f);
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507e-3f));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073e-3f));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894e-2f));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459e-1f));
+		p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201e-1f));
+		p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+
+		__m512 e = _mm512_scalef_ps(p, k);
+
+		return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+	}
+
+	// the rules of sixteen cells, the same in every lane for one universe or twice the eight universes of a LaneRules
+	struct RulesAVX512
+	{
+		__m512 dt;
+		__m512 b1;
+		__m512 b2;
+		__m512 d1b1; // d1 - b1
+		__m512 d2b2; // d2 - b2
+		__m512 slopeN; // 4 / alpha_n
+		__m512 slopeM; // 4 / alpha_m
+	};
+
+	// the LANES floats twice, for two cells per register like SumLaneTapsAVX512
+	__m512 LanePair(const float* lanes)
+	{
+		__m512 r = _mm512_castps256_ps512(_mm256_loadu_ps(lanes));
+		return _mm512_shuffle_f32x4(r, r, _MM_SHUFFLE(1, 0, 1, 0));
+	}
+
+	RulesAVX512 LoadRules(const CpuKernels::LaneRules& rules)
+	{
+		__m512 b1 = LanePair(rules.b1);
+		__m512 b2 = LanePair(rules.b2);
+		__m512 four = _mm512_set1_ps(4.0f);
+
+		return { LanePair(rules.dt), b1, b2, _mm512_sub_ps(LanePair(rules.d1), b1), _mm512_sub_ps(LanePair(rules.d2), b2), _mm512_div_ps(four, LanePair(rules.alpha_n)), _mm512_div_ps(four, LanePair(rules.alpha_m)) };
+	}
+
+	RulesAVX512 BroadcastRules(const CpuKernels::Rules& rules)
+	{
+		return { _mm512_set1_ps(rules.dt), _mm512_set1_ps(rules.b1), _mm512_set1_ps(rules.b2), _mm512_set1_ps(rules.d1 - rules.b1), _mm512_set1_ps(rules.d2 - rules.b2), _mm512_set1_ps(4.0f / rules.alpha_n), _mm512_set1_ps(4.0f / rules.alpha_m) };
+	}
+
+	// the steps of NextState() in Rules.h for sixteen cells
+	__m512 NextStateAVX512(const RulesAVX512& rules, __m512 v, __m512 n, __m512 m)
+	{
+		__m512 s = SigmoidAVX512(_mm512_mul_ps(_mm512_sub_ps(m, _mm512_set1_ps(0.5f)), rules.slopeM));
+		__m512 a = _mm512_fmadd_ps(rules.d1b1, s, rules.b1);
+		__m512 b = _mm512_fmadd_ps(rules.d2b2, s, rules.b2);
+
+		__m512 t = _mm512_mul_ps(SigmoidAVX512(_mm512_mul_ps(_mm512_sub_ps(n, a), rules.slopeN)), _mm512_sub_ps(_mm512_set1_ps(1.0f), SigmoidAVX512(_mm512_mul_ps(_mm512_sub_ps(n, b), rules.slopeN))));
+
+		__m512 next = _mm512_fmadd_ps(rules.dt, _mm512_sub_ps(_mm512_add_ps(t, t), _mm512_set1_ps(1.0f)), v);
+		return _mm512_min_ps(_mm512_max_ps(next, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+	}
+
+	void NextStatesAVX512(const CpuKernels::Rules& rules, const float* v, const float* n, const float* m, float* out, unsigned int count)
+	{
+		RulesAVX512 vector = BroadcastRules(rules);
+		unsigned int i = 0;
+
+		for (; i + 16 <= count; i += 16)
+		{
+			_mm512_storeu_ps(out + i, NextStateAVX512(vector, _mm512_loadu_ps(v + i), _mm512_loadu_ps(n + i), _mm512_loadu_ps(m + i)));
+		}
+
+		if (i < count)
+		{
+			__mmask16 mask = (__mmask16)((1u << (count - i)) - 1);
+			__m512 next = NextStateAVX512(vector, _mm512_maskz_loadu_ps(mask, v + i), _mm512_maskz_loadu_ps(mask, n + i), _mm512_maskz_loadu_ps(mask, m + i));
+
+			_mm512_mask_storeu_ps(out + i, mask, next);
+		}
+	}
+
+	void NextLaneStatesAVX512(const CpuKernels::LaneRules& rules, const float* v, const float* n, const float* m, float* out, unsigned int cells)
+	{
+		RulesAVX512 vector = LoadRules(rules);
+		unsigned int c = 0;
+
+		for (; c + 2 <= cells; c += 2)
+		{
+			size_t i = c * LANES;
+			_mm512_storeu_ps(out + i, NextStateAVX512(vector, _mm512_loadu_ps(v + i), _mm512_loadu_ps(n + i), _mm512_loadu_ps(m + i)));
+		}
+
+		// an odd last cell in the low half
+		if (c < cells)
+		{
+			size_t i = c * LANES;
+			__mmask16 mask = 0xFF;
+			__m512 next = NextStateAVX512(vector, _mm512_maskz_loadu_ps(mask, v + i), _mm512_maskz_loadu_ps(mask, n + i), _mm512_maskz_loadu_ps(mask, m + i));
+
+			_mm512_mask_storeu_ps(out + i, mask, next);
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+const CpuKernels::Table* CpuKernels::AVX512Table()
+{
+	static const Table table{ SumTapsAVX512, SumLaneTapsAVX512, SummariseAVX512, SumTapsU8AVX512, SumTapsU16AVX512, NextStatesAVX512, NextLaneStatesAVX512 };
+	return &table;
+}
+
+#else
+
+const CpuKernels::Table* CpuKernels::AVX512Table()
+{
+	return nullptr;
+}
+
+#endif
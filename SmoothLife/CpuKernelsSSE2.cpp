@@ -0,0 +1,408 @@
+#include "CpuKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// after the includes and only around the kernels, nothing else is compiled for SSE2
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace
+{
+	const unsigned int LANES = CpuKernels::LANES;
+
+	void SumTapsSSE2(const float* base, const CpuKernels::Tap* taps, size_t count, float* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m128 a0 = _mm_setzero_ps();
+			__m128 a1 = _mm_setzero_ps();
+			__m128 a2 = _mm_setzero_ps();
+			__m128 a3 = _mm_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + taps[t].offset + i;
+				__m128 w = _mm_set1_ps(taps[t].weight);
+
+				a0 = _mm_add_ps(a0, _mm_mul_ps(w, _mm_loadu_ps(p)));
+				a1 = _mm_add_ps(a1, _mm_mul_ps(w, _mm_loadu_ps(p + 4)));
+				a2 = _mm_add_ps(a2, _mm_mul_ps(w, _mm_loadu_ps(p + 8)));
+				a3 = _mm_add_ps(a3, _mm_mul_ps(w, _mm_loadu_ps(p + 12)));
+			}
+
+			_mm_storeu_ps(out + i, a0);
+			_mm_storeu_ps(out + i + 4, a1);
+			_mm_storeu_ps(out + i + 8, a2);
+			_mm_storeu_ps(out + i + 12, a3);
+		}
+
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 a = _mm_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a = _mm_add_ps(a, _mm_mul_ps(_mm_set1_ps(taps[t].weight), _mm_loadu_ps(base + taps[t].offset + i)));
+			}
+
+			_mm_storeu_ps(out + i, a);
+		}
+
+		for (; i < n; i++)
+		{
+			float a = 0.0f;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// two registers per cell, four cells share every weight load
+	void SumLaneTapsSSE2(const float* base, const std::ptrdiff_t* offsets, const float* weights, size_t count, float* out, unsigned int cells)
+	{
+		unsigned int c = 0;
+
+		for (; c + 4 <= cells; c += 4)
+		{
+			__m128 a0 = _mm_setzero_ps();
+			__m128 a1 = _mm_setzero_ps();
+			__m128 a2 = _mm_setzero_ps();
+			__m128 a3 = _mm_setzero_ps();
+			__m128 a4 = _mm_setzero_ps();
+			__m128 a5 = _mm_setzero_ps();
+			__m128 a6 = _mm_setzero_ps();
+			__m128 a7 = _mm_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + offsets[t] + c * LANES;
+				__m128 w0 = _mm_loadu_ps(weights + t * LANES);
+				__m128 w1 = _mm_loadu_ps(weights + t * LANES + 4);
+
+				a0 = _mm_add_ps(a0, _mm_mul_ps(w0, _mm_loadu_ps(p)));
+				a1 = _mm_add_ps(a1, _mm_mul_ps(w1, _mm_loadu_ps(p + 4)));
+				a2 = _mm_add_ps(a2, _mm_mul_ps(w0, _mm_loadu_ps(p + 8)));
+				a3 = _mm_add_ps(a3, _mm_mul_ps(w1, _mm_loadu_ps(p + 12)));
+				a4 = _mm_add_ps(a4, _mm_mul_ps(w0, _mm_loadu_ps(p + 16)));
+				a5 = _mm_add_ps(a5, _mm_mul_ps(w1, _mm_loadu_ps(p + 20)));
+				a6 = _mm_add_ps(a6, _mm_mul_ps(w0, _mm_loadu_ps(p + 24)));
+				a7 = _mm_add_ps(a7, _mm_mul_ps(w1, _mm_loadu_ps(p + 28)));
+			}
+
+			_mm_storeu_ps(out + c * LANES, a0);
+			_mm_storeu_ps(out + c * LANES + 4, a1);
+			_mm_storeu_ps(out + c * LANES + 8, a2);
+			_mm_storeu_ps(out + c * LANES + 12, a3);
+			_mm_storeu_ps(out + c * LANES + 16, a4);
+			_mm_storeu_ps(out + c * LANES + 20, a5);
+			_mm_storeu_ps(out + c * LANES + 24, a6);
+			_mm_storeu_ps(out + c * LANES + 28, a7);
+		}
+
+		for (; c < cells; c++)
+		{
+			__m128 a0 = _mm_setzero_ps();
+			__m128 a1 = _mm_setzero_ps();
+
+			for (size_t t = 0; t < count; t++)
+			{
+				const float* p = base + offsets[t] + c * LANES;
+
+				a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(weights + t * LANES), _mm_loadu_ps(p)));
+				a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(weights + t * LANES + 4), _mm_loadu_ps(p + 4)));
+			}
+
+			_mm_storeu_ps(out + c * LANES, a0);
+			_mm_storeu_ps(out + c * LANES + 4, a1);
+		}
+	}
+
+	// float partial sums over blocks short enough to keep their precision, the blocks add up in double
+	CpuKernels::Summary SummariseSSE2(const float* cells, size_t n)
+	{
+		const size_t BLOCK = 4096;
+
+		CpuKernels::Summary summary;
+		__m128 low = _mm_set1_ps(cells[0]);
+		__m128 high = low;
+
+		size_t i = 0;
+		for (; i + 4 <= n;)
+		{
+			size_t end = i + BLOCK < n ? i + BLOCK : n;
+			__m128 sum = _mm_setzero_ps();
+
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 v = _mm_loadu_ps(cells + i);
+				sum = _mm_add_ps(sum, v);
+				low = _mm_min_ps(low, v);
+				high = _mm_max_ps(high, v);
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, sum);
+			summary.sum += double(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+		}
+
+		float lows[4];
+		float highs[4];
+		_mm_storeu_ps(lows, low);
+		_mm_storeu_ps(highs, high);
+
+		summary.min = lows[0];
+		summary.max = highs[0];
+		for (int k = 1; k < 4; k++)
+		{
+			summary.min = lows[k] < summary.min ? lows[k] : summary.min;
+			summary.max = highs[k] > summary.max ? highs[k] : summary.max;
+		}
+
+		for (; i < n; i++)
+		{
+			summary.sum += cells[i];
+			summary.min = cells[i] < summary.min ? cells[i] : summary.min;
+			summary.max = cells[i] > summary.max ? cells[i] : summary.max;
+		}
+
+		return summary;
+	}
+
+	// the weights of taps t and t + 1 in the low and high half of every 32 bit lane
+	__m128i PairWeights(const CpuKernels::IntTap* taps, size_t t)
+	{
+		return _mm_set1_epi32((int)((std::uint16_t)taps[t].weight | ((std::uint32_t)(std::uint16_t)taps[t + 1].weight << 16)));
+	}
+
+	// interleaving the cells of two taps lets pmaddwd multiply and add both in one instruction
+	void SumTapsU8SSE2(const std::uint8_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		unsigned int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m128i a0 = _mm_setzero_si128();
+			__m128i a1 = _mm_setzero_si128();
+			__m128i a2 = _mm_setzero_si128();
+			__m128i a3 = _mm_setzero_si128();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m128i w = PairWeights(taps, t);
+				__m128i x = _mm_loadu_si128((const __m128i*)(base + taps[t].offset + i));
+				__m128i y = _mm_loadu_si128((const __m128i*)(base + taps[t + 1].offset + i));
+
+				__m128i low = _mm_unpacklo_epi8(x, y);
+				__m128i high = _mm_unpackhi_epi8(x, y);
+
+				a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), w));
+				a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), w));
+				a2 = _mm_add_epi32(a2, _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), w));
+				a3 = _mm_add_epi32(a3, _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), w));
+			}
+
+			_mm_storeu_si128((__m128i*)(out + i), a0);
+			_mm_storeu_si128((__m128i*)(out + i + 4), a1);
+			_mm_storeu_si128((__m128i*)(out + i + 8), a2);
+			_mm_storeu_si128((__m128i*)(out + i + 12), a3);
+		}
+
+		for (; i < n; i++)
+		{
+			std::int32_t a = 0;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * (std::int32_t)base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	void SumTapsU16SSE2(const std::uint16_t* base, const CpuKernels::IntTap* taps, size_t count, std::int32_t* out, unsigned int n)
+	{
+		unsigned int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m128i a0 = _mm_setzero_si128();
+			__m128i a1 = _mm_setzero_si128();
+			__m128i a2 = _mm_setzero_si128();
+			__m128i a3 = _mm_setzero_si128();
+
+			for (size_t t = 0; t < count; t += 2)
+			{
+				__m128i w = PairWeights(taps, t);
+				const std::uint16_t* p = base + taps[t].offset + i;
+				const std::uint16_t* q = base + taps[t + 1].offset + i;
+
+				__m128i x0 = _mm_loadu_si128((const __m128i*)p);
+				__m128i x1 = _mm_loadu_si128((const __m128i*)(p + 8));
+				__m128i y0 = _mm_loadu_si128((const __m128i*)q);
+				__m128i y1 = _mm_loadu_si128((const __m128i*)(q + 8));
+
+				a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(x0, y0), w));
+				a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(x0, y0), w));
+				a2 = _mm_add_epi32(a2, _mm_madd_epi16(_mm_unpacklo_epi16(x1, y1), w));
+				a3 = _mm_add_epi32(a3, _mm_madd_epi16(_mm_unpackhi_epi16(x1, y1), w));
+			}
+
+			_mm_storeu_si128((__m128i*)(out + i), a0);
+			_mm_storeu_si128((__m128i*)(out + i + 4), a1);
+			_mm_storeu_si128((__m128i*)(out + i + 8), a2);
+			_mm_storeu_si128((__m128i*)(out + i + 12), a3);
+		}
+
+		for (; i < n; i++)
+		{
+			std::int32_t a = 0;
+
+			for (size_t t = 0; t < count; t++)
+			{
+				a += taps[t].weight * (std::int32_t)base[taps[t].offset + i];
+			}
+
+			out[i] = a;
+		}
+	}
+
+	// 1 / (1 + exp(-z)) with the expf polynomial of Cephes, 2^k goes straight into the exponent bits
+	__m128 SigmoidSSE2(__m128 z)
+	{
+		__m128 x = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_set1_ps(-87.0f)), _mm_set1_ps(87.0f));
+
+		// exp(x) = 2^k exp(r) with |r| <= ln 2 / 2, the conversion rounds to nearest
+		__m128i k = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)));
+		__m128 kf = _mm_cvtepi32_ps(k);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(0.693359375f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 p = _mm_set1_ps(1.9875691500e-4f);
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), _mm_add_ps(r, _mm_set1_ps(1.0f)));
+
+		__m128 e = _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(k, _mm_set1_epi32(127)), 23)));
+
+		return _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), e));
+	}
+
+	// the rules of four cells, the same in every lane for one universe or one universe per lane
+	struct RulesSSE2
+	{
+		__m128 dt;
+		__m128 b1;
+		__m128 b2;
+		__m128 d1b1; // d1 - b1
+		__m128 d2b2; // d2 - b2
+		__m128 slopeN; // 4 / alpha_n
+		__m128 slopeM; // 4 / alpha_m
+	};
+
+	// the universes lane to lane + 3 of a LaneRules
+	RulesSSE2 LoadRules(const CpuKernels::LaneRules& rules, unsigned int lane)
+	{
+		__m128 b1 = _mm_loadu_ps(rules.b1 + lane);
+		__m128 b2 = _mm_loadu_ps(rules.b2 + lane);
+		__m128 four = _mm_set1_ps(4.0f);
+
+		return { _mm_loadu_ps(rules.dt + lane), b1, b2, _mm_sub_ps(_mm_loadu_ps(rules.d1 + lane), b1), _mm_sub_ps(_mm_loadu_ps(rules.d2 + lane), b2), _mm_div_ps(four, _mm_loadu_ps(rules.alpha_n + lane)), _mm_div_ps(four, _mm_loadu_ps(rules.alpha_m + lane)) };
+	}
+
+	RulesSSE2 BroadcastRules(const CpuKernels::Rules& rules)
+	{
+		return { _mm_set1_ps(rules.dt), _mm_set1_ps(rules.b1), _mm_set1_ps(rules.b2), _mm_set1_ps(rules.d1 - rules.b1), _mm_set1_ps(rules.d2 - rules.b2), _mm_set1_ps(4.0f / rules.alpha_n), _mm_set1_ps(4.0f / rules.alpha_m) };
+	}
+
+	// the steps of NextState() in Rules.h for four cells
+	__m128 NextStateSSE2(const RulesSSE2& rules, __m128 v, __m128 n, __m128 m)
+	{
+		__m128 s = SigmoidSSE2(_mm_mul_ps(_mm_sub_ps(m, _mm_set1_ps(0.5f)), rules.slopeM));
+		__m128 a = _mm_add_ps(rules.b1, _mm_mul_ps(rules.d1b1, s));
+		__m128 b = _mm_add_ps(rules.b2, _mm_mul_ps(rules.d2b2, s));
+
+		__m128 t = _mm_mul_ps(SigmoidSSE2(_mm_mul_ps(_mm_sub_ps(n, a), rules.slopeN)), _mm_sub_ps(_mm_set1_ps(1.0f), SigmoidSSE2(_mm_mul_ps(_mm_sub_ps(n, b), rules.slopeN))));
+
+		__m128 next = _mm_add_ps(v, _mm_mul_ps(rules.dt, _mm_sub_ps(_mm_add_ps(t, t), _mm_set1_ps(1.0f))));
+		return _mm_min_ps(_mm_max_ps(next, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	}
+
+	void NextStatesSSE2(const CpuKernels::Rules& rules, const float* v, const float* n, const float* m, float* out, unsigned int count)
+	{
+		RulesSSE2 vector = BroadcastRules(rules);
+		unsigned int i = 0;
+
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps(out + i, NextStateSSE2(vector, _mm_loadu_ps(v + i), _mm_loadu_ps(n + i), _mm_loadu_ps(m + i)));
+		}
+
+		// the last few cells of a row through a padded copy
+		if (i < count)
+		{
+			float cells[3][4] = {};
+			float next[4];
+
+			for (unsigned int j = 0; j < count - i; j++)
+			{
+				cells[0][j] = v[i + j];
+				cells[1][j] = n[i + j];
+				cells[2][j] = m[i + j];
+			}
+
+			_mm_storeu_ps(next, NextStateSSE2(vector, _mm_loadu_ps(cells[0]), _mm_loadu_ps(cells[1]), _mm_loadu_ps(cells[2])));
+
+			for (unsigned int j = 0; j < count - i; j++) out[i + j] = next[j];
+		}
+	}
+
+	// two registers per cell like SumLaneTapsSSE2, each half keeps the rules of its four universes
+	void NextLaneStatesSSE2(const CpuKernels::LaneRules& rules, const float* v, const float* n, const float* m, float* out, unsigned int cells)
+	{
+		RulesSSE2 low = LoadRules(rules, 0);
+		RulesSSE2 high = LoadRules(rules, 4);
+
+		for (unsigned int i = 0; i < cells * LANES; i += LANES)
+		{
+			_mm_storeu_ps(out + i, NextStateSSE2(low, _mm_loadu_ps(v + i), _mm_loadu_ps(n + i), _mm_loadu_ps(m + i)));
+			_mm_storeu_ps(out + i + 4, NextStateSSE2(high, _mm_loadu_ps(v + i + 4), _mm_loadu_ps(n + i + 4), _mm_loadu_ps(m + i + 4)));
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+const CpuKernels::Table* CpuKernels::SSE2Table()
+{
+	static const Table table{ SumTapsSSE2, SumLaneTapsSSE2, SummariseSSE2, SumTapsU8SSE2, SumTapsU16SSE2, NextStatesSSE2, NextLaneStatesSSE2 };
+	return &table;
+}
+
+#else
+
+const CpuKernels::Table* CpuKernels::SSE2Table()
+{
+	return nullptr;
+}
+
+#endif
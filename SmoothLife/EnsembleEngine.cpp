@@ -0,0 +1,174 @@
+#include "EnsembleEngine.h"
+#include "Trace.h"
+#include "CpuKernels.h"
+#include <stdexcept>
+
+EnsembleEngine::EnsembleEngine(unsigned int resolutionX, unsigned int resolutionY, const std::vector<Uniforms>& universes, const std::vector<unsigned int>& seeds, unsigned int threads)
+	: resX{resolutionX}, resY{resolutionY}, count{(unsigned int)universes.size()}, pool{threads}
+{
+	if (resX == 0 || resY == 0) throw std::runtime_error{ "Ensemble engine needs a non empty grid" };
+
+	CpuKernels::Select();
+	if (universes.empty()) throw std::runtime_error{ "An ensemble needs at least one universe" };
+	if (seeds.size() != universes.size()) throw std::runtime_error{ "An ensemble needs one seed per universe" };
+
+	for (const Uniforms& uniforms : universes)
+	{
+		halo = std::max(halo, (unsigned int)std::ceil(uniforms.ra));
+	}
+
+	if (halo > resX || halo > resY) throw std::runtime_error{ "ra is larger than the grid" };
+
+	stride = resX + 2 * halo;
+
+	groups.resize((count + LANES - 1) / LANES);
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		Group& group = groups[g];
+
+		// the spare lanes of the last group step a copy of the last universe from an empty grid
+		for (unsigned int l = 0; l < LANES; l++)
+		{
+			const Uniforms& uniforms = universes[std::min<size_t>(g * LANES + l, count - 1)];
+			group.uniforms[l] = uniforms;
+
+			group.rules.dt[l] = uniforms.dt;
+			group.rules.alpha_n[l] = uniforms.alpha_n;
+			group.rules.alpha_m[l] = uniforms.alpha_m;
+			group.rules.b1[l] = uniforms.b1;
+			group.rules.b2[l] = uniforms.b2;
+			group.rules.d1[l] = uniforms.d1;
+			group.rules.d2[l] = uniforms.d2;
+		}
+
+		BuildTaps(group);
+
+		group.current.assign((size_t)stride * (resY + 2 * halo) * LANES, 0.0f);
+		group.next.assign(group.current.size(), 0.0f);
+
+		for (unsigned int l = 0; l < LANES && g * LANES + l < count; l++)
+		{
+			std::vector<float> cells = SeedState(resX, resY, seeds[g * LANES + l], universes[g * LANES + l].ra);
+
+			for (unsigned int y = 0; y < resY; y++)
+			{
+				for (unsigned int x = 0; x < resX; x++)
+				{
+					group.current[Cell(x, y) + l] = cells[y * resX + x];
+				}
+			}
+		}
+
+		for (unsigned int row = 0; row < resY + 2 * halo; row++)
+		{
+			FillHalo(group.current, row);
+		}
+	}
+}
+
+void EnsembleEngine::Step()
+{
+	Trace::Zone zone{ "EnsembleEngine::Step" };
+
+	unsigned int rows = resY + 2 * halo;
+
+	pool.Run((unsigned int)groups.size() * resY, [this](unsigned int task) { StepRow(groups[task / resY], task % resY); });
+	pool.Run((unsigned int)groups.size() * rows, [this, rows](unsigned int task) { FillHalo(groups[task / rows].next, task % rows); });
+
+	for (Group& group : groups)
+	{
+		group.current.swap(group.next);
+	}
+}
+
+std::vector<float> EnsembleEngine::GetState(unsigned int universe) const
+{
+	if (universe >= count) throw std::runtime_error{ "Universe " + std::to_string(universe) + " is not in the ensemble" };
+
+	const Group& group = groups[universe / LANES];
+	unsigned int l = universe % LANES;
+
+	std::vector<float> state(resX * resY);
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		for (unsigned int x = 0; x < resX; x++)
+		{
+			state[y * resX + x] = group.current[Cell(x, y) + l];
+		}
+	}
+
+	return state;
+}
+
+// the union of the kernels of every lane, in the order BuildKernelTaps lists them
+// so each lane sums its own taps in the same order as CpuEngine
+void EnsembleEngine::BuildTaps(Group& group) const
+{
+	int r = 0;
+	for (const Uniforms& uniforms : group.uniforms)
+	{
+		r = std::max(r, (int)std::ceil(uniforms.ra));
+	}
+
+	int width = 2 * r + 1;
+
+	struct Slot
+	{
+		bool used = false;
+		float weights[LANES] = {};
+	};
+
+	std::vector<Slot> inner(width * width);
+	std::vector<Slot> outer(width * width);
+
+	for (unsigned int l = 0; l < LANES; l++)
+	{
+		for (const KernelTap& tap : BuildKernelTaps(group.uniforms[l].ri, group.uniforms[l].ra))
+		{
+			Slot& slot = (tap.inner ? inner : outer)[(tap.y + r) * width + tap.x + r];
+			slot.used = true;
+			slot.weights[l] = tap.weight;
+		}
+	}
+
+	auto emit = [this, r, width](const std::vector<Slot>& slots, Taps& taps)
+	{
+		taps.offsets.clear();
+		taps.weights.clear();
+
+		for (int i = 0; i < width * width; i++)
+		{
+			if (!slots[i].used) continue;
+
+			int x = i % width - r;
+			int y = i / width - r;
+
+			taps.offsets.push_back(((std::ptrdiff_t)y * stride + x) * LANES);
+			taps.weights.insert(taps.weights.end(), slots[i].weights, slots[i].weights + LANES);
+		}
+	};
+
+	emit(inner, group.innerTaps);
+	emit(outer, group.outerTaps);
+}
+
+void EnsembleEngine::StepRow(Group& group, unsigned int y)
+{
+	float outer[TILE * LANES];
+	float inner[TILE * LANES];
+
+	for (unsigned int x0 = 0; x0 < resX; x0 += TILE)
+	{
+		unsigned int width = std::min(TILE, resX - x0);
+
+		const float* src = &group.current[Cell(x0, y)];
+		float* dst = &group.next[Cell(x0, y)];
+
+		CpuKernels::SumLaneTaps(src, group.outerTaps.offsets.data(), group.outerTaps.weights.data(), group.outerTaps.offsets.size(), outer, width);
+		CpuKernels::SumLaneTaps(src, group.innerTaps.offsets.data(), group.innerTaps.weights.data(), group.innerTaps.offsets.size(), inner, width);
+
+		CpuKernels::NextLaneStates(group.rules, src, outer, inner, dst, width);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Rules.h"
+#include "ThreadPool.h"
+#include "CpuKernels.h"
+#include "PaddedGrid.h"
+
+/*
+
+Native step of many small independent universes at once, for ensembles and parameter sweeps
+
+Universes are stepped in groups of LANES. The grid of a group is stored cell by cell with the
+LANES universes of a cell next to each other, so one vector load reads the same cell of every
+universe and the SIMD lane is the universe. Each tap of the kernel has a weight per lane,
+which lets the universes of a group have different radii (a tap outside one universe's kernel
+weighs 0 there), and the convolution needs no gather or shuffle.
+The transition runs on the same layout, NextLaneStates keeps the rules of each universe in its lane.
+
+Like CpuEngine the grids keep a wrapped border of ceil(ra) cells, the largest ra of all universes.
+
+*/
+
+class EnsembleEngine
+{
+public:
+	static constexpr unsigned int LANES = CpuKernels::LANES;
+
+	// one seed per universe, 0 threads uses every hardware thread
+	EnsembleEngine(unsigned int resolutionX, unsigned int resolutionY, const std::vector<Uniforms>& universes, const std::vector<unsigned int>& seeds, unsigned int threads = 0);
+
+	// one timestep of every universe
+	void Step();
+
+	// row major resX * resY of one universe, row 0 is the bottom row like the textures
+	std::vector<float> GetState(unsigned int universe) const;
+
+	unsigned int GetCount() const { return count; }
+	unsigned int GetThreadCount() const { return pool.GetThreadCount(); }
+
+private:
+	static constexpr unsigned int TILE = 64;
+
+	// offsets into the padded grid of a group, LANES weights per tap
+	struct Taps
+	{
+		std::vector<std::ptrdiff_t> offsets;
+		std::vector<float> weights;
+	};
+
+	struct Group
+	{
+		Uniforms uniforms[LANES];
+		CpuKernels::LaneRules rules;
+
+		Taps innerTaps;
+		Taps outerTaps;
+
+		std::vector<float> current;
+		std::vector<float> next;
+	};
+
+	void BuildTaps(Group& group) const;
+	void StepRow(Group& group, unsigned int y);
+	void FillHalo(std::vector<float>& grid, unsigned int row) const { ::FillHalo(grid.data(), resX, resY, halo, stride, LANES, row); }
+
+	size_t Cell(unsigned int x, unsigned int y) const { return ((size_t)(y + halo) * stride + x + halo) * LANES; }
+
+private:
+	unsigned int resX;
+	unsigned int resY;
+	unsigned int count;
+
+	unsigned int halo = 0;
+	unsigned int stride = 0;
+
+	std::vector<Group> groups;
+
+	ThreadPool pool;
+};
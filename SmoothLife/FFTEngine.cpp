@@ -0,0 +1,213 @@
+#include "Simulation.h"
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+void Simulation::FFTEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY)
+{
+	if (!CanTransform(resolutionX, resolutionY)) throw std::runtime_error{ "FFT sides need prime factors up to " + std::to_string(MAX_RADIX) };
+
+	resX = resolutionX;
+	resY = resolutionY;
+
+	factorsX = Factorise(resX);
+	factorsY = Factorise(resY);
+
+	std::string vert = shaderDir + "default.vert";
+	fft = Shader{ vert.c_str(), (shaderDir + "fft.frag").c_str() };
+	multiply = Shader{ vert.c_str(), (shaderDir + "fft_multiply.frag").c_str() };
+	transition = Shader{ vert.c_str(), (shaderDir + "fft_transition.frag").c_str() };
+
+	transition.BindUniformBlock("SimData", 0);
+
+	fft.Use();
+	fft.SetInt(INPUT_UNIFORM, WORK_UNIT);
+
+	multiply.Use();
+	multiply.SetInt(INPUT_UNIFORM, WORK_UNIT);
+	multiply.SetInt("kernelIn", KERNEL_UNIT);
+
+	transition.Use();
+	transition.SetInt(INPUT_UNIFORM, 0);
+	transition.SetInt("convolution", WORK_UNIT);
+	transition.SetFloat("scale", 1.0f / (float(resX) * float(resY)));
+
+	// keep unit 0 (the state) untouched
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+
+	targets[0] = CreateTarget(resX, resY);
+	targets[1] = CreateTarget(resX, resY);
+	kernel = CreateTarget(resX, resY);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	initialised = true;
+}
+
+void Simulation::FFTEngine::Step(const Uniforms& uniforms, unsigned int outFbo)
+{
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glViewport(0, 0, resX, resY);
+
+	if (uniforms.ri != kernelRi || uniforms.ra != kernelRa)
+	{
+		BuildKernel(uniforms.ri, uniforms.ra);
+	}
+
+	// forward transform of the state
+	int cur = Transform(STATE, 0, -1.0f);
+	cur = Transform(cur, 1, -1.0f);
+
+	// multiply by the kernel spectrum
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, targets[cur].texture);
+	glActiveTexture(GL_TEXTURE0 + KERNEL_UNIT);
+	glBindTexture(GL_TEXTURE_2D, kernel.texture);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targets[1 - cur].fbo);
+	multiply.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	cur = 1 - cur;
+
+	// inverse transform gives the outer sum in the real part and the inner sum in the imaginary part
+	cur = Transform(cur, 0, 1.0f);
+	cur = Transform(cur, 1, 1.0f);
+
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, targets[cur].texture);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	transition.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+bool Simulation::FFTEngine::CanTransform(unsigned int resolutionX, unsigned int resolutionY)
+{
+	for (unsigned int n : { resolutionX, resolutionY })
+	{
+		std::vector<unsigned int> factors = Factorise(n);
+		if (!factors.empty() && *std::max_element(factors.begin(), factors.end()) > MAX_RADIX) return false;
+	}
+
+	return true;
+}
+
+// splits n into the radices of the passes
+// radix 4 first to save passes, a prime factor p costs p fetches per texel, see CanTransform()
+std::vector<unsigned int> Simulation::FFTEngine::Factorise(unsigned int n)
+{
+	std::vector<unsigned int> factors;
+
+	while (n % 4 == 0)
+	{
+		factors.push_back(4);
+		n /= 4;
+	}
+
+	for (unsigned int p = 2; n > 1; p++)
+	{
+		while (n % p == 0)
+		{
+			factors.push_back(p);
+			n /= p;
+		}
+	}
+
+	return factors;
+}
+
+Simulation::FFTEngine::Target Simulation::FFTEngine::CreateTarget(unsigned int resolutionX, unsigned int resolutionY)
+{
+	Target target;
+
+	glGenFramebuffers(1, &target.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+	glGenTextures(1, &target.texture);
+	glBindTexture(GL_TEXTURE_2D, target.texture);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, resolutionX, resolutionY, 0, GL_RG, GL_FLOAT, nullptr);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "FFT framebuffer is not complete" };
+
+	return target;
+}
+
+// same weights as convolve() in simulation.frag, wrapped around the torus
+void Simulation::FFTEngine::BuildKernel(float ri, float ra)
+{
+	// real = outer annulus, imaginary = inner disk
+	std::vector<float> weights(resX * resY * 2, 0.0f);
+
+	for (const KernelTap& tap : BuildKernelTaps(ri, ra))
+	{
+		unsigned int x = (unsigned int)(((tap.x % (int)resX) + (int)resX) % (int)resX);
+		unsigned int y = (unsigned int)(((tap.y % (int)resY) + (int)resY) % (int)resY);
+
+		weights[(y * resX + x) * 2 + (tap.inner ? 1 : 0)] += tap.weight;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, targets[0].texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resX, resY, GL_RG, GL_FLOAT, weights.data());
+
+	int cur = Transform(0, 0, -1.0f);
+	cur = Transform(cur, 1, -1.0f);
+
+	// keep the spectrum and hand the old kernel target back as scratch space
+	std::swap(kernel, targets[cur]);
+
+	kernelRi = ri;
+	kernelRa = ra;
+}
+
+int Simulation::FFTEngine::Transform(int src, int axis, float direction)
+{
+	const std::vector<unsigned int>& factors = axis == 0 ? factorsX : factorsY;
+	unsigned int n = axis == 0 ? resX : resY;
+
+	fft.Use();
+	fft.SetInt("N", n);
+	fft.SetInt("axis", axis);
+	fft.SetFloat("direction", direction);
+
+	unsigned int ns = 1;
+	for (unsigned int radix : factors)
+	{
+		int dst = src == 0 ? 1 : 0;
+
+		// the first pass of a step reads the state straight from unit 0
+		fft.SetBool("fromState", src == STATE);
+		fft.SetInt(INPUT_UNIFORM, src == STATE ? 0 : WORK_UNIT);
+
+		if (src != STATE)
+		{
+			glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+			glBindTexture(GL_TEXTURE_2D, targets[src].texture);
+		}
+
+		fft.SetInt("R", radix);
+		fft.SetInt("Ns", ns);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, targets[dst].fbo);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+		ns *= radix;
+		src = dst;
+	}
+
+	return src;
+}
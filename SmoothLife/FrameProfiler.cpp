@@ -0,0 +1,180 @@
+#include "Simulation.h"
+#include "Trace.h"
+#include <fstream>
+#include <algorithm>
+
+void Simulation::FrameProfiler::Init()
+{
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		if (IsGpu((Pass)i)) glGenQueries(RING, timelines[i].queries);
+
+		timelines[i].history.reserve(HISTORY);
+	}
+
+	initialised = true;
+}
+
+void Simulation::FrameProfiler::BeginFrame()
+{
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		if (!IsGpu((Pass)i)) continue;
+
+		Timeline& timeline = timelines[i];
+
+		for (unsigned int slot = 0; slot < RING; slot++)
+		{
+			if (!timeline.pending[slot]) continue;
+
+			int available = 0;
+			glGetQueryObjectiv(timeline.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) continue;
+
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(timeline.queries[slot], GL_QUERY_RESULT, &ns);
+
+			timeline.pending[slot] = false;
+			Add(timeline, timeline.queryFrames[slot], float(double(ns) * 1e-6));
+		}
+	}
+
+	frame++;
+}
+
+void Simulation::FrameProfiler::Begin(Pass pass)
+{
+	Timeline& timeline = timelines[(int)pass];
+	timeline.traceStart = Trace::Now();
+
+	if (!IsGpu(pass))
+	{
+		timeline.cpuStart = std::chrono::steady_clock::now();
+		return;
+	}
+
+	// the oldest query has not come back yet, skip this one rather than wait for it
+	if (timeline.pending[timeline.next]) return;
+
+	timeline.open = timeline.next;
+	timeline.next = (timeline.next + 1) % RING;
+
+	glBeginQuery(GL_TIME_ELAPSED, timeline.queries[timeline.open]);
+}
+
+void Simulation::FrameProfiler::End(Pass pass)
+{
+	Timeline& timeline = timelines[(int)pass];
+
+	// the CPU side of every pass also goes into the trace, for GPU passes that is the time to submit
+	Trace::Record(PASS_NAMES[(int)pass], timeline.traceStart, Trace::Now());
+
+	if (!IsGpu(pass))
+	{
+		Add(timeline, frame, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeline.cpuStart).count());
+		return;
+	}
+
+	if (timeline.open == -1) return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+
+	timeline.pending[timeline.open] = true;
+	timeline.queryFrames[timeline.open] = frame;
+	timeline.open = -1;
+}
+
+Simulation::FrameProfiler::Stats Simulation::FrameProfiler::GetStats(Pass pass) const
+{
+	const Timeline& timeline = timelines[(int)pass];
+
+	Stats stats;
+	stats.samples = timeline.history.size();
+	if (stats.samples == 0) return stats;
+
+	std::vector<float> ms(stats.samples);
+	for (size_t i = 0; i < stats.samples; i++) ms[i] = timeline.history[i].ms;
+
+	auto percentile = [&ms](float p)
+	{
+		auto nth = ms.begin() + std::min(ms.size() - 1, size_t(p * ms.size()));
+		std::nth_element(ms.begin(), nth, ms.end());
+		return *nth;
+	};
+
+	stats.p50 = percentile(0.50f);
+	stats.p99 = percentile(0.99f);
+
+	return stats;
+}
+
+bool Simulation::FrameProfiler::WriteCsv(const std::string& path) const
+{
+	std::ofstream file{ path };
+	if (!file) return false;
+
+	file << "frame,pass,device,ms\n";
+
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		for (const Sample& sample : Ordered(timelines[i]))
+		{
+			file << sample.frame << ',' << PASS_NAMES[i] << ',' << (IsGpu((Pass)i) ? "gpu" : "cpu") << ',' << sample.ms << '\n';
+		}
+	}
+
+	return (bool)file;
+}
+
+bool Simulation::FrameProfiler::WriteJson(const std::string& path) const
+{
+	std::ofstream file{ path };
+	if (!file) return false;
+
+	file << "{\n";
+
+	for (int i = 0; i < PASS_COUNT; i++)
+	{
+		Stats stats = GetStats((Pass)i);
+
+		file << "\t\"" << PASS_NAMES[i] << "\": { \"device\": \"" << (IsGpu((Pass)i) ? "gpu" : "cpu")
+			<< "\", \"p50\": " << stats.p50 << ", \"p99\": " << stats.p99 << ", \"frames\": [";
+
+		std::vector<Sample> samples = Ordered(timelines[i]);
+		for (size_t k = 0; k < samples.size(); k++) file << (k ? ", " : "") << samples[k].frame;
+
+		file << "], \"ms\": [";
+		for (size_t k = 0; k < samples.size(); k++) file << (k ? ", " : "") << samples[k].ms;
+
+		file << "] }" << (i + 1 < PASS_COUNT ? "," : "") << '\n';
+	}
+
+	file << "}\n";
+
+	return (bool)file;
+}
+
+void Simulation::FrameProfiler::Add(Timeline& timeline, unsigned long long frame, float ms)
+{
+	if (timeline.history.size() < HISTORY)
+	{
+		timeline.history.push_back({ frame, ms });
+		return;
+	}
+
+	timeline.history[timeline.head] = { frame, ms };
+	timeline.head = (timeline.head + 1) % HISTORY;
+}
+
+std::vector<Simulation::FrameProfiler::Sample> Simulation::FrameProfiler::Ordered(const Timeline& timeline)
+{
+	std::vector<Sample> samples;
+	samples.reserve(timeline.history.size());
+
+	for (size_t i = 0; i < timeline.history.size(); i++)
+	{
+		samples.push_back(timeline.history[(timeline.head + i) % timeline.history.size()]);
+	}
+
+	return samples;
+}
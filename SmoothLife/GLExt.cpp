@@ -0,0 +1,70 @@
+#include "GLExt.h"
+#include <cstring>
+
+GLExt::DispatchComputeProc GLExt::DispatchCompute = nullptr;
+GLExt::BindImageTextureProc GLExt::BindImageTexture = nullptr;
+GLExt::MemoryBarrierProc GLExt::MemoryBarrier = nullptr;
+GLExt::MaxShaderCompilerThreadsProc GLExt::MaxShaderCompilerThreads = nullptr;
+GLExt::GetProgramBinaryProc GLExt::GetProgramBinary = nullptr;
+GLExt::ProgramBinaryProc GLExt::ProgramBinary = nullptr;
+GLExt::ProgramParameteriProc GLExt::ProgramParameteri = nullptr;
+bool GLExt::ParallelShaderCompile = false;
+
+void GLExt::Load(GLADloadproc load)
+{
+	DispatchCompute = (DispatchComputeProc)load("glDispatchCompute");
+	BindImageTexture = (BindImageTextureProc)load("glBindImageTexture");
+	MemoryBarrier = (MemoryBarrierProc)load("glMemoryBarrier");
+
+	GetProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+	ProgramBinary = (ProgramBinaryProc)load("glProgramBinary");
+	ProgramParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+
+	MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsKHR");
+	if (MaxShaderCompilerThreads == nullptr) MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsARB");
+
+	ParallelShaderCompile = HasExtension("GL_KHR_parallel_shader_compile") || HasExtension("GL_ARB_parallel_shader_compile");
+
+	// the initial thread count is up to the driver, 0xFFFFFFFF lets it use as many as it likes
+	if (ParallelShaderCompile && MaxShaderCompilerThreads != nullptr) MaxShaderCompilerThreads(0xFFFFFFFF);
+}
+
+int GLExt::Version()
+{
+	int major = 0;
+	int minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	return major * 10 + minor;
+}
+
+bool GLExt::HasCompute()
+{
+	// some loaders return stubs for unknown names so the version decides
+	return Version() >= 43 && DispatchCompute != nullptr && BindImageTexture != nullptr && MemoryBarrier != nullptr;
+}
+
+bool GLExt::HasProgramBinary()
+{
+	if (Version() < 41 && !HasExtension("GL_ARB_get_program_binary")) return false;
+	if (GetProgramBinary == nullptr || ProgramBinary == nullptr || ProgramParameteri == nullptr) return false;
+
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	return formats > 0;
+}
+
+bool GLExt::HasExtension(const char* name)
+{
+	int count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+
+Entry points and enums newer than the GL 3.3 core profile glad was generated for.
+They are looked up with the same loader after gladLoadGLLoader,
+a pointer stays null when the driver does not provide the function.
+
+*/
+
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#define GL_COMPLETION_STATUS 0x91B1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+struct GLExt
+{
+	typedef void (APIENTRYP DispatchComputeProc)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+	typedef void (APIENTRYP BindImageTextureProc)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+	typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+	typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+	static DispatchComputeProc DispatchCompute;
+	static BindImageTextureProc BindImageTexture;
+	static MemoryBarrierProc MemoryBarrier;
+	// ARB_parallel_shader_compile and KHR_parallel_shader_compile
+	static MaxShaderCompilerThreadsProc MaxShaderCompilerThreads;
+	// GL 4.1 or ARB_get_program_binary
+	static GetProgramBinaryProc GetProgramBinary;
+	static ProgramBinaryProc ProgramBinary;
+	static ProgramParameteriProc ProgramParameteri;
+
+	// GL_COMPLETION_STATUS can be polled without waiting for the compiler, set by Load
+	static bool ParallelShaderCompile;
+
+	// needs the context to be current
+	static void Load(GLADloadproc load);
+
+	// GL version of the current context as major * 10 + minor
+	static int Version();
+	// GL 4.3 or newer and every compute entry point was found
+	static bool HasCompute();
+	// the entry points were found and the driver offers at least one binary format
+	static bool HasProgramBinary();
+	static bool HasExtension(const char* name);
+};
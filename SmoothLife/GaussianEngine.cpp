@@ -0,0 +1,133 @@
+#include "Simulation.h"
+#include <stdexcept>
+
+void Simulation::GaussianEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+
+	std::string vert = shaderDir + "default.vert";
+	blur = Shader{ vert.c_str(), (shaderDir + "gaussian_blur.frag").c_str() };
+	transition = Shader{ vert.c_str(), (shaderDir + "gaussian_transition.frag").c_str() };
+
+	transition.BindUniformBlock("SimData", 0);
+
+	blur.Use();
+	blur.SetInt("weights", WEIGHT_UNIT);
+	blur.SetIVec2("resolution", (int)resX, (int)resY);
+
+	transition.Use();
+	transition.SetInt(INPUT_UNIFORM, 0);
+	transition.SetInt("blurred", WORK_UNIT);
+
+	// keep unit 0 (the state) untouched
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+
+	for (Target& target : targets)
+	{
+		glGenFramebuffers(1, &target.fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+		glGenTextures(1, &target.texture);
+		glBindTexture(GL_TEXTURE_2D, target.texture);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resX, resY, 0, GL_RGBA, GL_FLOAT, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Gaussian framebuffer is not complete" };
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(1, &buffer);
+	glGenTextures(1, &texture);
+
+	initialised = true;
+}
+
+void Simulation::GaussianEngine::Step(const Uniforms& uniforms, int terms, unsigned int outFbo)
+{
+	terms = std::clamp(terms, 1, GaussianFit::MAX_TERMS);
+
+	if (uniforms.ri != fitRi || uniforms.ra != fitRa || terms != fit.terms)
+	{
+		Fit(uniforms.ri, uniforms.ra, terms);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + WEIGHT_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+
+	blur.Use();
+
+	// horizontal, the state into every channel
+	blur.SetBool("fromState", true);
+	blur.SetInt(INPUT_UNIFORM, 0);
+	blur.SetIVec2("direction", 1, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targets[0].fbo);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	// vertical
+	blur.SetBool("fromState", false);
+	blur.SetInt(INPUT_UNIFORM, WORK_UNIT);
+	blur.SetIVec2("direction", 0, 1);
+
+	glActiveTexture(GL_TEXTURE0 + WORK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, targets[0].texture);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targets[1].fbo);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, targets[1].texture);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	transition.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Simulation::GaussianEngine::Fit(float ri, float ra, int terms)
+{
+	fit = FitGaussianMixture(ri, ra, terms);
+
+	int radius = 0;
+	for (int k = 0; k < fit.terms; k++) radius = std::max(radius, fit.radius[k]);
+
+	// unused channels keep a weight of 0
+	std::vector<float> table((radius + 1) * 4, 0.0f);
+	for (int k = 0; k < fit.terms; k++)
+	{
+		for (int i = 0; i <= fit.radius[k]; i++)
+		{
+			table[i * 4 + k] = std::exp(-float(i * i) / (2.0f * fit.sigma[k] * fit.sigma[k]));
+		}
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(float), table.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + WEIGHT_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	blur.Use();
+	blur.SetInt("radius", radius);
+
+	transition.Use();
+	transition.SetVec4("outerWeights", fit.outer[0], fit.outer[1], fit.outer[2], fit.outer[3]);
+	transition.SetVec4("innerWeights", fit.inner[0], fit.inner[1], fit.inner[2], fit.inner[3]);
+
+	fitRi = ri;
+	fitRa = ra;
+}
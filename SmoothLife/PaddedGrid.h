@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+
+/*
+
+The native engines keep their grids with a border of halo cells on every side
+so the taps of a kernel never wrap. The border holds copies of the cells on the
+opposite edge of the torus. A cell is lanes values next to each other, one for
+CpuEngine and QuantizedEngine and one per universe for EnsembleEngine.
+
+*/
+
+// rewrites the border cells of one padded row from the wrapped interior
+// stride is the padded width in cells, row counts from the first border row
+template<typename T>
+void FillHalo(T* grid, unsigned int resX, unsigned int resY, unsigned int halo, unsigned int stride, unsigned int lanes, unsigned int row)
+{
+	unsigned int y = (row + resY - halo) % resY;
+	T* dst = grid + (size_t)row * stride * lanes;
+	const T* src = grid + ((size_t)(y + halo) * stride + halo) * lanes;
+
+	bool interior = row >= halo && row < resY + halo;
+
+	if (!interior)
+	{
+		std::copy_n(src, (size_t)resX * lanes, dst + (size_t)halo * lanes);
+	}
+
+	std::copy_n(src + (size_t)(resX - halo) * lanes, (size_t)halo * lanes, dst);
+	std::copy_n(src, (size_t)halo * lanes, dst + (size_t)(halo + resX) * lanes);
+}
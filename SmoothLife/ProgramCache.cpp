@@ -0,0 +1,136 @@
+#include "Simulation.h"
+#include "GLExt.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+std::string Simulation::ProgramCache::directory = "./shader_cache/";
+
+void Simulation::ProgramCache::SetDirectory(const std::string& directory)
+{
+	ProgramCache::directory = directory;
+
+	if (!directory.empty() && directory.back() != '/' && directory.back() != '\\') ProgramCache::directory += '/';
+}
+
+// 64 bit FNV-1a, only has to tell sources apart, not resist anyone
+std::string Simulation::ProgramCache::Key(std::initializer_list<const std::string*> sources)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+
+	auto add = [&hash](const char* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+
+		// separator so moving text from one string to the next changes the hash
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+	};
+
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const char* driver = (const char*)glGetString(name);
+		if (driver != nullptr) add(driver, std::strlen(driver));
+	}
+
+	for (const std::string* source : sources) add(source->data(), source->size());
+
+	std::ostringstream key;
+	key << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+	return key.str();
+}
+
+unsigned int Simulation::ProgramCache::Load(const std::string& key)
+{
+	if (!Enabled()) return 0;
+
+	std::ifstream file{ Path(key), std::ios::binary };
+	if (!file) return 0;
+
+	GLenum format = 0;
+	file.read((char*)&format, sizeof(format));
+	if (!file) return 0;
+
+	std::vector<char> binary{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+	if (binary.empty()) return 0;
+
+	unsigned int program = glCreateProgram();
+	GLExt::ProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// rebuilt from source and stored again by the caller
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+void Simulation::ProgramCache::Prepare(unsigned int program)
+{
+	if (Enabled()) GLExt::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void Simulation::ProgramCache::Store(unsigned int program, const std::string& key)
+{
+	if (!Enabled()) return;
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) return;
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	GLExt::GetProgramBinary(program, length, &length, &format, binary.data());
+	if (length <= 0) return;
+
+	// a cache that cannot be written is only slower
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// many processes can start at once, each writes its own file and renames it into place
+	std::string path = Path(key);
+	std::string temporary = path + '.' + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	{
+		std::ofstream file{ temporary, std::ios::binary };
+		file.write((const char*)&format, sizeof(format));
+		file.write(binary.data(), length);
+
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(temporary, path, error);
+	if (error) std::filesystem::remove(temporary, error);
+}
+
+bool Simulation::ProgramCache::Enabled()
+{
+	return !directory.empty() && GLExt::HasProgramBinary();
+}
+
+std::string Simulation::ProgramCache::Path(const std::string& key)
+{
+	return directory + key + ".bin";
+}
@@ -0,0 +1,214 @@
+#include "Simulation.h"
+#include <stdexcept>
+#include <string>
+
+void Simulation::PyramidEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+
+	// every level needs at least one texel
+	levels = 0;
+	while (levels < MAX_LEVEL && (std::min(resX, resY) >> (levels + 1)) > 0) levels++;
+
+	std::string vert = shaderDir + "default.vert";
+	box = Shader{ vert.c_str(), (shaderDir + "pyramid_box.frag").c_str() };
+	shader = Shader{ vert.c_str(), (shaderDir + "simulation_pyramid.frag").c_str() };
+
+	shader.BindUniformBlock("SimData", 0);
+
+	box.Use();
+	box.SetVec2("resolution", (float)resX, (float)resY);
+
+	shader.Use();
+	shader.SetInt(INPUT_UNIFORM, 0);
+	shader.SetInt("table", TABLE_UNIT);
+	shader.SetVec2("resolution", (float)resX, (float)resY);
+	shader.SetVec2("invResolution", 1.0f / float(resX), 1.0f / float(resY));
+
+	for (int level = 1; level <= MAX_LEVEL; level++)
+	{
+		shader.SetInt("level" + std::to_string(level), LEVEL_UNIT + level - 1);
+	}
+
+	// keep unit 0 (the state) untouched
+	glActiveTexture(GL_TEXTURE0 + SOURCE_UNIT);
+
+	for (int level = 1; level <= levels; level++)
+	{
+		Target& target = levelTargets[level - 1];
+
+		glGenFramebuffers(1, &target.fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+		glGenTextures(1, &target.texture);
+		glBindTexture(GL_TEXTURE_2D, target.texture);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resX, resY, 0, GL_RED, GL_FLOAT, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Pyramid framebuffer is not complete" };
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(1, &buffer);
+	glGenTextures(1, &texture);
+
+	initialised = true;
+}
+
+void Simulation::PyramidEngine::Step(const Uniforms& uniforms, int maxLevel, unsigned int outFbo)
+{
+	maxLevel = std::min(std::max(maxLevel, 1), levels);
+
+	if (uniforms.ri != tableRi || uniforms.ra != tableRa || maxLevel != tableLevel)
+	{
+		BuildTable(uniforms.ri, uniforms.ra, maxLevel);
+	}
+
+	// level 1 from the state on unit 0, every other level from the one below it
+	box.Use();
+
+	for (int level = 1; level <= maxLevel; level++)
+	{
+		if (level > 1)
+		{
+			glActiveTexture(GL_TEXTURE0 + SOURCE_UNIT);
+			glBindTexture(GL_TEXTURE_2D, levelTargets[level - 2].texture);
+		}
+
+		box.SetInt(INPUT_UNIFORM, level == 1 ? 0 : SOURCE_UNIT);
+		box.SetInt("halfSize", 1 << (level - 1));
+
+		glBindFramebuffer(GL_FRAMEBUFFER, levelTargets[level - 1].fbo);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	}
+
+	for (int level = 1; level <= maxLevel; level++)
+	{
+		glActiveTexture(GL_TEXTURE0 + LEVEL_UNIT + level - 1);
+		glBindTexture(GL_TEXTURE_2D, levelTargets[level - 1].texture);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	shader.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+// same weights as convolve() in simulation.frag
+void Simulation::PyramidEngine::BuildTable(float ri, float ra, int maxLevel)
+{
+	int r = (int)std::ceil(ra);
+	if (r > (int)resX || r > (int)resY) throw std::runtime_error{ "ra is larger than the grid" };
+
+	std::vector<KernelTap> kernelTaps = BuildKernelTaps(ri, ra);
+
+	float full = 0.0f;
+	for (const KernelTap& tap : kernelTaps)
+	{
+		if (!tap.inner) full = std::max(full, tap.weight);
+	}
+
+	// cells of the bounding square that may be read from a coarser level
+	int side = 2 * r + 1;
+	std::vector<bool> coarse(side * side, false);
+
+	for (const KernelTap& tap : kernelTaps)
+	{
+		if (!tap.inner && tap.weight == full)
+		{
+			coarse[(tap.y + r) * side + tap.x + r] = true;
+		}
+	}
+
+	auto isCoarse = [&](int x, int y) { return x >= -r && x <= r && y >= -r && y <= r && coarse[(y + r) * side + x + r]; };
+
+	// largest blocks first, aligned to their size, each block takes its cells out of the coarse set
+	std::vector<float> blocks[MAX_LEVEL];
+
+	for (int level = maxLevel; level >= 1; level--)
+	{
+		int size = 1 << level;
+		int start = -((r + size - 1) / size) * size;
+
+		for (int by = start; by <= r; by += size)
+		{
+			for (int bx = start; bx <= r; bx += size)
+			{
+				bool inside = true;
+				for (int y = by; y < by + size && inside; y++)
+				{
+					for (int x = bx; x < bx + size && inside; x++)
+					{
+						inside = isCoarse(x, y);
+					}
+				}
+
+				if (!inside) continue;
+
+				for (int y = by; y < by + size; y++)
+				{
+					for (int x = bx; x < bx + size; x++)
+					{
+						coarse[(y + r) * side + x + r] = false;
+					}
+				}
+
+				// the level holds the mean of the block
+				blocks[level - 1].insert(blocks[level - 1].end(), { (float)bx, (float)by, full * float(size * size), 0.0f });
+			}
+		}
+	}
+
+	// every cell no block took, the coarse set now only holds the leftovers of the tiling
+	std::vector<float> table;
+	int tapCount = 0;
+
+	for (const KernelTap& tap : kernelTaps)
+	{
+		bool tiled = !tap.inner && tap.weight == full && !isCoarse(tap.x, tap.y);
+		if (tiled) continue;
+
+		table.push_back((float)tap.x);
+		table.push_back((float)tap.y);
+		table.push_back(tap.inner ? 0.0f : tap.weight);
+		table.push_back(tap.inner ? tap.weight : 0.0f);
+		tapCount++;
+	}
+
+	shader.Use();
+	shader.SetInt("tapCount", tapCount);
+
+	// the blocks of every level after the taps, level 1 first
+	for (int level = 1; level <= MAX_LEVEL; level++)
+	{
+		table.insert(table.end(), blocks[level - 1].begin(), blocks[level - 1].end());
+		shader.SetInt("level" + std::to_string(level) + "End", (int)(table.size() / 4));
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(float), table.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	tableRi = ri;
+	tableRa = ra;
+	tableLevel = maxLevel;
+}
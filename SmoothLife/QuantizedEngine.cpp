@@ -0,0 +1,243 @@
+#include "QuantizedEngine.h"
+#include "Trace.h"
+#include "CpuKernels.h"
+#include <stdexcept>
+#include <limits>
+#include <string>
+
+namespace
+{
+	// as large as the 16 bit weights allow while ONE times the sum of the rounded weights,
+	// the largest ring sum, still fits into 32 bits
+	template<typename T>
+	double WeightScale(const std::vector<KernelTap>& taps, bool inner)
+	{
+		double max = 0.0;
+		double sum = 0.0;
+		double count = 0.0;
+
+		for (const KernelTap& tap : taps)
+		{
+			if (tap.inner != inner) continue;
+
+			max = std::max(max, (double)tap.weight);
+			sum += tap.weight;
+			count++;
+		}
+
+		double budget = (double)std::numeric_limits<std::int32_t>::max() / QuantizedEngine<T>::ONE - count;
+		return std::min((double)std::numeric_limits<std::int16_t>::max() / max, budget / sum);
+	}
+}
+
+template<typename T>
+QuantizedEngine<T>::QuantizedEngine(unsigned int resolutionX, unsigned int resolutionY, unsigned int threads)
+	: resX{resolutionX}, resY{resolutionY}, pool{threads}
+{
+	if (resX == 0 || resY == 0) throw std::runtime_error{ "Quantized engine needs a non empty grid" };
+
+	CpuKernels::Select();
+
+	Resize(0);
+}
+
+template<typename T>
+void QuantizedEngine<T>::Seed(unsigned int seed, float radius)
+{
+	SetState(SeedState(resX, resY, seed, radius));
+}
+
+template<typename T>
+void QuantizedEngine<T>::Step(const Uniforms& uniforms)
+{
+	Trace::Zone zone{ "QuantizedEngine::Step" };
+
+	if (uniforms.ri != tapsRi || uniforms.ra != tapsRa)
+	{
+		BuildTaps(uniforms.ri, uniforms.ra);
+	}
+
+	unsigned int tilesX = (resX + TILE - 1) / TILE;
+	unsigned int tilesY = (resY + TILE - 1) / TILE;
+
+	CpuKernels::Rules rules{ uniforms.dt, uniforms.alpha_n, uniforms.alpha_m, uniforms.b1, uniforms.b2, uniforms.d1, uniforms.d2 };
+
+	pool.Run(tilesX * tilesY, [this, &rules](unsigned int tile) { StepTile(tile, rules); });
+	pool.Run(resY + 2 * halo, [this](unsigned int row) { FillHalo(next, row); });
+
+	current.swap(next);
+}
+
+template<typename T>
+std::vector<float> QuantizedEngine<T>::GetState() const
+{
+	std::vector<float> state(resX * resY);
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		const T* row = Cell(current, 0, y);
+
+		for (unsigned int x = 0; x < resX; x++)
+		{
+			state[y * resX + x] = row[x] * (1.0f / ONE);
+		}
+	}
+
+	return state;
+}
+
+template<typename T>
+void QuantizedEngine<T>::SetState(const std::vector<float>& state)
+{
+	if (state.size() != (size_t)resX * resY) throw std::runtime_error{ "State does not match the grid size" };
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		T* row = Cell(current, 0, y);
+
+		for (unsigned int x = 0; x < resX; x++)
+		{
+			row[x] = (T)(std::clamp(state[y * resX + x], 0.0f, 1.0f) * ONE + 0.5f);
+		}
+	}
+
+	for (unsigned int row = 0; row < resY + 2 * halo; row++)
+	{
+		FillHalo(current, row);
+	}
+}
+
+template<typename T>
+void QuantizedEngine<T>::BuildTaps(float ri, float ra)
+{
+	unsigned int newHalo = (unsigned int)std::ceil(ra);
+	if (newHalo != halo) Resize(newHalo);
+
+	std::vector<KernelTap> taps = BuildKernelTaps(ri, ra);
+
+	auto quantise = [this, &taps, ri, ra](bool inner, Kernel& kernel)
+	{
+		double scale = WeightScale<T>(taps, inner);
+		double exactSum = 0.0;
+		std::int64_t sum = 0;
+
+		kernel.taps.clear();
+
+		for (const KernelTap& tap : taps)
+		{
+			if (tap.inner != inner) continue;
+
+			exactSum += tap.weight;
+
+			// rim taps too light for the scale drop out, the norm below accounts for them
+			std::int16_t weight = (std::int16_t)std::lround(tap.weight * scale);
+			if (weight == 0) continue;
+
+			kernel.taps.push_back({ (std::ptrdiff_t)tap.y * stride + tap.x, weight });
+			sum += weight;
+		}
+
+		if (sum == 0) throw std::runtime_error{ "Kernel of ri " + std::to_string(ri) + " ra " + std::to_string(ra) + " is empty" };
+
+		// the kernels take the taps in pairs
+		if (kernel.taps.size() % 2 != 0) kernel.taps.push_back({ kernel.taps.back().offset, 0 });
+
+		// the sums keep the total weight of the float kernel, the rounding of the weights cancels out
+		kernel.norm = float(exactSum / (double(ONE) * sum));
+	};
+
+	quantise(true, innerKernel);
+	quantise(false, outerKernel);
+
+	tapsRi = ri;
+	tapsRa = ra;
+}
+
+// keeps the state but changes the width of the wrapped border
+template<typename T>
+void QuantizedEngine<T>::Resize(unsigned int newHalo)
+{
+	if (newHalo > resX || newHalo > resY) throw std::runtime_error{ "ra is larger than the grid" };
+
+	std::vector<T> state(resX * resY, 0);
+
+	if (!current.empty())
+	{
+		for (unsigned int y = 0; y < resY; y++)
+		{
+			std::copy_n(Cell(current, 0, y), resX, &state[y * resX]);
+		}
+	}
+
+	halo = newHalo;
+	stride = resX + 2 * halo;
+
+	current.assign(stride * (resY + 2 * halo), 0);
+	next.assign(current.size(), 0);
+
+	for (unsigned int y = 0; y < resY; y++)
+	{
+		std::copy_n(&state[y * resX], resX, Cell(current, 0, y));
+	}
+
+	for (unsigned int row = 0; row < resY + 2 * halo; row++)
+	{
+		FillHalo(current, row);
+	}
+}
+
+template<>
+void QuantizedEngine<std::uint8_t>::SumTaps(const std::uint8_t* base, const Kernel& kernel, std::int32_t* out, unsigned int n)
+{
+	CpuKernels::SumTapsU8(base, kernel.taps.data(), kernel.taps.size(), out, n);
+}
+
+template<>
+void QuantizedEngine<std::uint16_t>::SumTaps(const std::uint16_t* base, const Kernel& kernel, std::int32_t* out, unsigned int n)
+{
+	CpuKernels::SumTapsU16(base, kernel.taps.data(), kernel.taps.size(), out, n);
+}
+
+template<typename T>
+void QuantizedEngine<T>::StepTile(unsigned int tile, const CpuKernels::Rules& rules)
+{
+	unsigned int tilesX = (resX + TILE - 1) / TILE;
+	unsigned int x0 = (tile % tilesX) * TILE;
+	unsigned int y0 = (tile / tilesX) * TILE;
+	unsigned int width = std::min(TILE, resX - x0);
+	unsigned int height = std::min(TILE, resY - y0);
+
+	std::int32_t outer[TILE];
+	std::int32_t inner[TILE];
+
+	float v[TILE];
+	float n[TILE];
+	float m[TILE];
+	float state[TILE];
+
+	for (unsigned int y = y0; y < y0 + height; y++)
+	{
+		const T* src = Cell(current, x0, y);
+		T* dst = Cell(next, x0, y);
+
+		SumTaps(src, outerKernel, outer, width);
+		SumTaps(src, innerKernel, inner, width);
+
+		for (unsigned int x = 0; x < width; x++)
+		{
+			v[x] = src[x] * (1.0f / ONE);
+			n[x] = outer[x] * outerKernel.norm;
+			m[x] = inner[x] * innerKernel.norm;
+		}
+
+		CpuKernels::NextStates(rules, v, n, m, state, width);
+
+		for (unsigned int x = 0; x < width; x++)
+		{
+			dst[x] = (T)(state[x] * ONE + 0.5f);
+		}
+	}
+}
+
+template class QuantizedEngine<std::uint8_t>;
+template class QuantizedEngine<std::uint16_t>;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Rules.h"
+#include "ThreadPool.h"
+#include "CpuKernels.h"
+#include "PaddedGrid.h"
+
+/*
+
+Fixed point variant of CpuEngine with 8 or 16 bit cells
+
+A cell stores its state as an integer from 0 to ONE. The kernel weights are scaled to 16 bit
+integers and the ring sums are exact 32 bit sums, two taps per multiply add (see SumTapsU8 in
+CpuKernels.h), so a u8 grid moves a quarter of the bytes of the float grid of CpuEngine.
+The sums are rescaled so the integer weights add up to the same total as the float ones,
+the transition of a row is evaluated in float by CpuKernels::NextStates, a vector at a time,
+and the new state is rounded back to the grid.
+
+u16 cells keep 15 bits (ONE = 32767) as the multiply adds take signed 16 bit inputs.
+The rounding of the state makes the results drift from the float engines. With u8 cells, single
+cells near a front can be fully off within ten steps. SmoothLife --quantized reports by how much.
+
+*/
+
+template<typename T>
+class QuantizedEngine
+{
+public:
+	static_assert(sizeof(T) <= 2, "cells are 8 or 16 bit");
+
+	// the value of a cell in state 1
+	static constexpr int ONE = sizeof(T) == 1 ? 255 : 32767;
+
+	// 0 threads uses every hardware thread
+	QuantizedEngine(unsigned int resolutionX, unsigned int resolutionY, unsigned int threads = 0);
+
+	// see SeedState() in Rules.h
+	void Seed(unsigned int seed, float radius);
+	void Step(const Uniforms& uniforms);
+
+	// row major resX * resY in [0, 1], row 0 is the bottom row like the textures
+	std::vector<float> GetState() const;
+	void SetState(const std::vector<float>& state);
+
+	unsigned int GetResolutionX() const { return resX; }
+	unsigned int GetResolutionY() const { return resY; }
+	unsigned int GetThreadCount() const { return pool.GetThreadCount(); }
+
+private:
+	static constexpr unsigned int TILE = 64;
+
+	// integer taps of one kernel and the factor that turns their sum into the float sum of CpuEngine
+	struct Kernel
+	{
+		std::vector<CpuKernels::IntTap> taps;
+		float norm = 0.0f;
+	};
+
+	void BuildTaps(float ri, float ra);
+	void Resize(unsigned int newHalo);
+	void StepTile(unsigned int tile, const CpuKernels::Rules& rules);
+	void FillHalo(std::vector<T>& grid, unsigned int row) const { ::FillHalo(grid.data(), resX, resY, halo, stride, 1, row); }
+
+	static void SumTaps(const T* base, const Kernel& kernel, std::int32_t* out, unsigned int n);
+
+	T* Cell(std::vector<T>& grid, unsigned int x, unsigned int y) { return &grid[(y + halo) * stride + x + halo]; }
+	const T* Cell(const std::vector<T>& grid, unsigned int x, unsigned int y) const { return &grid[(y + halo) * stride + x + halo]; }
+
+private:
+	unsigned int resX;
+	unsigned int resY;
+
+	unsigned int halo = 0;
+	unsigned int stride = 0;
+
+	std::vector<T> current;
+	std::vector<T> next;
+
+	// offsets into the padded grid
+	Kernel innerKernel;
+	Kernel outerKernel;
+	float tapsRi = -1.0f;
+	float tapsRa = -1.0f;
+
+	ThreadPool pool;
+};
+
+typedef QuantizedEngine<std::uint8_t> QuantizedEngine8;
+typedef QuantizedEngine<std::uint16_t> QuantizedEngine16;
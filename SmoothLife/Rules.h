@@ -0,0 +1,311 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+/*
+
+SmoothLife rules shared by the native implementations
+mirrors shaders/rules.glsl and convolve() in shaders/simulation.frag
+
+https://arxiv.org/pdf/1111.1567
+
+*/
+
+// layout matches the std140 SimData block in the shaders
+struct Uniforms
+{
+	float ri = 3.0f;
+	float ra = 13.0f;
+	float dt = 0.4f;
+	float alpha_m = 0.147f;
+
+	float alpha_n = 0.028f;
+	float b1 = 0.261f;
+	float b2 = 0.312f;
+	float d1 = 0.327f;
+
+	float d2 = 0.544f;
+
+	// != 0 makes the shaders read transition() from a lookup texture, the native code always evaluates it
+	int useTransitionLut = 1;
+};
+
+constexpr float PI = 3.14159265f;
+
+inline float Sigmoid1(float x, float a, float al)
+{
+	return 1.0f / (1.0f + std::exp(-(x - a) * 4.0f / al));
+}
+
+inline float Sigmoid2(float x, float a, float b, float al)
+{
+	return Sigmoid1(x, a, al) * (1.0f - Sigmoid1(x, b, al));
+}
+
+inline float SigmoidM(float x, float y, float m, float al)
+{
+	return x * (1.0f - Sigmoid1(m, 0.5f, al)) + y * Sigmoid1(m, 0.5f, al);
+}
+
+// n := outer ring sum, m := inner disk sum (both normalised)
+inline float Transition(const Uniforms& u, float n, float m)
+{
+	return Sigmoid2(n, SigmoidM(u.b1, u.d1, m, u.alpha_m), SigmoidM(u.b2, u.d2, m, u.alpha_m), u.alpha_n);
+}
+
+inline float NextState(const Uniforms& u, float v, float n, float m)
+{
+	return std::clamp(v + u.dt * (2.0f * Transition(u, n, m) - 1.0f), 0.0f, 1.0f);
+}
+
+// antialiasing zone of width b around the rim
+inline float Ramp(float l, float r)
+{
+	const float b = 1.0f;
+	return std::clamp(-l / b + (r + b / 2.0f) / b, 0.0f, 1.0f);
+}
+
+struct KernelTap
+{
+	int x;
+	int y;
+	float weight; // already divided by PI ri^2 (inner) or PI ra^2 (outer) like convolve()
+	bool inner;
+};
+
+// every cell within ra of the centre with the weights used by convolve()
+// the offsets are whole cells for any ra, convolve() and the batch shaders walk the same lattice
+inline std::vector<KernelTap> BuildKernelTaps(float ri, float ra)
+{
+	std::vector<KernelTap> taps;
+
+	float innerArea = PI * ri * ri;
+	float outerArea = PI * ra * ra;
+
+	int r = (int)std::ceil(ra);
+	for (int y = -r; y <= r; y++)
+	{
+		for (int x = -r; x <= r; x++)
+		{
+			float lsq = float(x * x + y * y);
+			if (lsq > ra * ra) continue;
+
+			if (lsq <= ri * ri)
+				taps.push_back({ x, y, Ramp(std::sqrt(lsq), ri) / innerArea, true });
+			else
+				taps.push_back({ x, y, Ramp(std::sqrt(lsq), ra) / outerArea, false });
+		}
+	}
+
+	return taps;
+}
+
+// both ring kernels as weighted sums of the same separable Gaussians exp(-(x^2 + y^2) / (2 sigma^2))
+// each Gaussian is one horizontal and one vertical blur, truncated at 3 sigma
+struct GaussianFit
+{
+	static constexpr int MAX_TERMS = 4;
+
+	int terms = 0;
+	float sigma[MAX_TERMS] = {};
+	int radius[MAX_TERMS] = {};
+	float outer[MAX_TERMS] = {};
+	float inner[MAX_TERMS] = {};
+
+	// ||approximation - exact|| / ||exact|| over all cells
+	float outerError = 0.0f;
+	float innerError = 0.0f;
+};
+
+namespace GaussianFitDetail
+{
+	// 1D taps of a truncated Gaussian
+	inline std::vector<double> Taps(float sigma, int radius)
+	{
+		std::vector<double> taps(2 * radius + 1);
+		for (int i = -radius; i <= radius; i++)
+		{
+			taps[i + radius] = std::exp(-double(i * i) / (2.0 * double(sigma) * double(sigma)));
+		}
+		return taps;
+	}
+
+	// least squares weights for the given sigmas, returns the sum of the squared relative errors
+	inline double Solve(GaussianFit& fit, const std::vector<KernelTap>& kernelTaps, double outerNorm, double innerNorm)
+	{
+		int n = fit.terms;
+		std::vector<std::vector<double>> taps(n);
+		for (int k = 0; k < n; k++)
+		{
+			fit.radius[k] = std::max(1, (int)std::ceil(3.0f * fit.sigma[k]));
+			taps[k] = Taps(fit.sigma[k], fit.radius[k]);
+		}
+
+		// the basis functions are separable so the gram matrix is a product of 1D sums
+		double gram[GaussianFit::MAX_TERMS][GaussianFit::MAX_TERMS];
+		for (int k = 0; k < n; k++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				int r = std::min(fit.radius[k], fit.radius[j]);
+				double sum = 0.0;
+				for (int i = -r; i <= r; i++) sum += taps[k][i + fit.radius[k]] * taps[j][i + fit.radius[j]];
+				gram[k][j] = sum * sum;
+			}
+		}
+
+		// projections of both kernels onto each basis function
+		double rhs[2][GaussianFit::MAX_TERMS] = {};
+		for (const KernelTap& tap : kernelTaps)
+		{
+			for (int k = 0; k < n; k++)
+			{
+				int r = fit.radius[k];
+				if (std::abs(tap.x) > r || std::abs(tap.y) > r) continue;
+
+				rhs[tap.inner ? 1 : 0][k] += tap.weight * taps[k][tap.x + r] * taps[k][tap.y + r];
+			}
+		}
+
+		double error = 0.0;
+		double norms[2] = { outerNorm, innerNorm };
+		float* weights[2] = { fit.outer, fit.inner };
+		float* errors[2] = { &fit.outerError, &fit.innerError };
+
+		for (int ring = 0; ring < 2; ring++)
+		{
+			// gaussian elimination with a small ridge, close sigmas make the system ill conditioned
+			double a[GaussianFit::MAX_TERMS][GaussianFit::MAX_TERMS + 1];
+			for (int k = 0; k < n; k++)
+			{
+				for (int j = 0; j < n; j++) a[k][j] = gram[k][j] + (k == j ? 1e-9 * gram[k][k] : 0.0);
+				a[k][n] = rhs[ring][k];
+			}
+
+			for (int k = 0; k < n; k++)
+			{
+				int pivot = k;
+				for (int j = k + 1; j < n; j++) if (std::abs(a[j][k]) > std::abs(a[pivot][k])) pivot = j;
+				std::swap(a[k], a[pivot]);
+
+				for (int j = k + 1; j < n; j++)
+				{
+					double f = a[j][k] / a[k][k];
+					for (int c = k; c <= n; c++) a[j][c] -= f * a[k][c];
+				}
+			}
+
+			double c[GaussianFit::MAX_TERMS];
+			for (int k = n - 1; k >= 0; k--)
+			{
+				double sum = a[k][n];
+				for (int j = k + 1; j < n; j++) sum -= a[k][j] * c[j];
+				c[k] = sum / a[k][k];
+			}
+
+			// ||Gc - w||^2 = c'Gc - 2c'b + ||w||^2
+			double residual = norms[ring] * norms[ring];
+			for (int k = 0; k < n; k++)
+			{
+				residual -= 2.0 * c[k] * rhs[ring][k];
+				for (int j = 0; j < n; j++) residual += c[k] * gram[k][j] * c[j];
+			}
+
+			double relative = std::sqrt(std::max(0.0, residual)) / norms[ring];
+			error += relative * relative;
+
+			for (int k = 0; k < n; k++) weights[ring][k] = (float)c[k];
+			*errors[ring] = (float)relative;
+		}
+
+		return error;
+	}
+}
+
+// fits the sigmas by coordinate descent on log sigma and the weights by least squares
+// the weights are scaled like BuildKernelTaps() so the blurred sums are already normalised
+inline GaussianFit FitGaussianMixture(float ri, float ra, int terms)
+{
+	GaussianFit fit;
+	fit.terms = std::clamp(terms, 1, GaussianFit::MAX_TERMS);
+
+	std::vector<KernelTap> kernelTaps = BuildKernelTaps(ri, ra);
+
+	double outerNorm = 0.0;
+	double innerNorm = 0.0;
+	for (const KernelTap& tap : kernelTaps)
+	{
+		(tap.inner ? innerNorm : outerNorm) += double(tap.weight) * tap.weight;
+	}
+	outerNorm = std::sqrt(outerNorm);
+	innerNorm = std::sqrt(innerNorm);
+
+	// spread between the inner disk and the rim of the annulus
+	for (int k = 0; k < fit.terms; k++)
+	{
+		fit.sigma[k] = std::max(0.5f, ra * float(k + 1) / float(fit.terms + 1));
+	}
+
+	double best = GaussianFitDetail::Solve(fit, kernelTaps, outerNorm, innerNorm);
+	float step = 1.3f;
+
+	while (step > 1.005f)
+	{
+		bool improved = false;
+
+		for (int k = 0; k < fit.terms; k++)
+		{
+			for (float factor : { step, 1.0f / step })
+			{
+				GaussianFit trial = fit;
+				trial.sigma[k] = std::clamp(fit.sigma[k] * factor, 0.3f, ra);
+
+				double error = GaussianFitDetail::Solve(trial, kernelTaps, outerNorm, innerNorm);
+				if (error < best)
+				{
+					best = error;
+					fit = trial;
+					improved = true;
+					break;
+				}
+			}
+		}
+
+		if (!improved) step = std::sqrt(step);
+	}
+
+	// leave the weights and errors of the best sigmas
+	GaussianFitDetail::Solve(fit, kernelTaps, outerNorm, innerNorm);
+
+	return fit;
+}
+
+// random filled squares of side 2 * radius covering about a quarter of the grid
+// row major resX * resY, the same seed always gives the same grid
+inline std::vector<float> SeedState(unsigned int resX, unsigned int resY, unsigned int seed, float radius)
+{
+	std::vector<float> state(resX * resY, 0.0f);
+	std::mt19937 rng{ seed };
+
+	int side = std::max(1, (int)(2.0f * radius));
+	unsigned int count = std::max(1u, (resX * resY) / (unsigned int)(side * side * 4));
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int x0 = rng() % resX;
+		unsigned int y0 = rng() % resY;
+
+		for (int y = 0; y < side; y++)
+		{
+			for (int x = 0; x < side; x++)
+			{
+				state[((y0 + y) % resY) * resX + (x0 + x) % resX] = 1.0f;
+			}
+		}
+	}
+
+	return state;
+}
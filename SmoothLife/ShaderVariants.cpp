@@ -0,0 +1,97 @@
+#include "Simulation.h"
+#include "GLExt.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+void Simulation::ShaderVariants::Init(const std::string& vertexPath, const std::string& fragmentPath, std::function<void(const Shader&)> setup, bool blocking)
+{
+	vertp = vertexPath;
+	fragp = fragmentPath;
+	this->setup = setup;
+	this->blocking = blocking;
+
+	// IsFinished() cannot tell a pending link apart from a finished one, the first IsLinked() would block
+	enabled = blocking || GLExt::ParallelShaderCompile;
+
+	initialised = true;
+}
+
+const Simulation::Shader* Simulation::ShaderVariants::Get(const Uniforms& uniforms)
+{
+	if (!enabled) return nullptr;
+
+	Variant* variant = lastVariant;
+
+	if (variant == nullptr || std::memcmp(&uniforms, &lastUniforms, sizeof(Uniforms)) != 0)
+	{
+		std::string defines = Defines(uniforms);
+
+		auto found = std::find_if(variants.begin(), variants.end(), [&defines](const Variant& v) { return v.defines == defines; });
+
+		if (found == variants.end())
+		{
+			// make room by dropping the least recently used one
+			if (variants.size() >= MAX_VARIANTS)
+			{
+				auto oldest = std::min_element(variants.begin(), variants.end(), [](const Variant& a, const Variant& b) { return a.lastUse < b.lastUse; });
+				oldest->shader.Delete();
+				variants.erase(oldest);
+			}
+
+			variants.push_back({ defines, Shader::Build(vertp.c_str(), fragp.c_str(), defines) });
+			found = variants.end() - 1;
+		}
+
+		variant = &*found;
+		lastVariant = variant;
+		lastUniforms = uniforms;
+	}
+
+	variant->lastUse = ++uses;
+
+	if (variant->failed) return nullptr;
+
+	if (!variant->ready)
+	{
+		if (!blocking && !variant->shader.IsFinished()) return nullptr;
+
+		if (!variant->shader.IsLinked())
+		{
+			variant->failed = true;
+			return nullptr;
+		}
+
+		int current;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+
+		variant->shader.Use();
+		setup(variant->shader);
+		glUseProgram(current);
+
+		variant->ready = true;
+	}
+
+	return &variant->shader;
+}
+
+// the values are written with 9 significant digits so they read back as the same floats
+std::string Simulation::ShaderVariants::Defines(const Uniforms& uniforms)
+{
+	std::ostringstream defines;
+	defines << std::scientific;
+	defines.precision(8);
+
+	defines << "#define SPECIALISED\n";
+	defines << "#define SPECIALISED_RI " << uniforms.ri << '\n';
+	defines << "#define SPECIALISED_RA " << uniforms.ra << '\n';
+	defines << "#define SPECIALISED_DT " << uniforms.dt << '\n';
+	defines << "#define SPECIALISED_ALPHA_M " << uniforms.alpha_m << '\n';
+	defines << "#define SPECIALISED_ALPHA_N " << uniforms.alpha_n << '\n';
+	defines << "#define SPECIALISED_B1 " << uniforms.b1 << '\n';
+	defines << "#define SPECIALISED_B2 " << uniforms.b2 << '\n';
+	defines << "#define SPECIALISED_D1 " << uniforms.d1 << '\n';
+	defines << "#define SPECIALISED_D2 " << uniforms.d2 << '\n';
+
+	return defines.str();
+}
@@ -1,4 +1,6 @@
 #include "Simulation.h"
+#include "GLExt.h"
+#include "Trace.h"
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
@@ -6,23 +8,58 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
-Simulation::Simulation(const std::string& vertexShader, const std::string& simVertShader, const std::string& fragmentShader, const std::string& passthroughFrag, const std::string& brushFrag, unsigned int resolutionX, unsigned int resolutionY, unsigned int windowWidth, unsigned int windowHeight)
-	: gui{uniforms, color}, vertp{vertexShader}, fragp{fragmentShader}, brushp{brushFrag}, simvp{simVertShader}, passp{passthroughFrag}, resX{resolutionX}, resY{resolutionY}, width{windowWidth}, height{windowHeight}
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+Simulation::Simulation(const std::string& vertexShader, const std::string& simVertShader, const std::string& fragmentShader, const std::string& brushFrag, unsigned int resolutionX, unsigned int resolutionY, unsigned int windowWidth, unsigned int windowHeight, bool headless)
+	: gui{uniforms, options, color}, vertp{vertexShader}, fragp{fragmentShader}, brushp{brushFrag}, simvp{simVertShader}, shaderDir{fragmentShader.substr(0, fragmentShader.find_last_of("/\\") + 1)}, resX{resolutionX}, resY{resolutionY}, width{windowWidth}, height{windowHeight}, headless{headless}
 {}
 
+Simulation::~Simulation()
+{
+#if defined(__linux__)
+	if (eglDisplay != nullptr)
+	{
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+	}
+#endif
+}
+
 void Simulation::Init()
 {
-	InitGLFW();
+	Trace::Zone zone{ "Simulation::Init" };
+
+	if (headless)
+		InitHeadless();
+	else
+		InitGLFW();
+
 	InitQuad();
 	InitRendering();
 
+	computeAvailable = GLExt::HasCompute();
+
 	shader = Shader{ simvp.c_str(), fragp.c_str() };
-	passthrough = Shader{ vertp.c_str(), passp.c_str() };
+	gather = Shader{ simvp.c_str(), (shaderDir + "simulation_gather.frag").c_str() };
 	brush = Shader{ vertp.c_str(), brushp.c_str() };
+	display = Shader{ vertp.c_str(), (shaderDir + "display.frag").c_str() };
 
-	gui.SetWindow(window);
-	gui.Init();
+	// set every frame
+	displayColor = display.Uniform("color");
+	brushXy = brush.Uniform("xy");
+
+	if (!headless)
+	{
+		gui.SetWindow(window);
+		gui.Init();
+	}
 
 	// generate UBO and bind
 
@@ -31,97 +68,343 @@ void Simulation::Init()
 	glBufferData(GL_UNIFORM_BUFFER, sizeof(Uniforms), &uniforms, GL_STATIC_DRAW);
 	glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
 
-	unsigned int bufferIdx = glGetUniformBlockIndex(shader.GetId(), "SimData");
-	glUniformBlockBinding(shader.GetId(), bufferIdx, 0);
+	for (const Shader* program : { &shader, &gather })
+	{
+		program->BindUniformBlock("SimData", 0);
+	}
+
+	// the same uniforms as the generic program gets in BindPipeline
+	// without a window nobody is waiting on the frame, so headless runs compile on the spot
+	shaderVariants.Init(simvp, fragp, [this](const Shader& program)
+	{
+		program.BindUniformBlock("SimData", 0);
+
+		program.SetInt(INPUT_UNIFORM, 0);
+		program.SetVec2("resolution", (float)resX, (float)resY);
+		program.SetVec2("invResolution", 1.0f / float(resX), 1.0f / float(resY));
+	}, headless);
+
+	if (!headless && !GLExt::ParallelShaderCompile) std::cout << "No parallel shader compile, the step uses the generic program" << std::endl;
 }
 
 void Simulation::MainLoop()
 {
-	glBindVertexArray(vao);
+	BindPipeline();
 
-	// bind texture0
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture0);
+	bool vsync = true;
+	glfwSwapInterval(1);
 
-	// bind texutre1
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
+	unsigned int steps = 1;
+	double frameStart = glfwGetTime();
 
-	glDisable(GL_DEPTH_TEST);
+	if (!profiler.IsInitialised()) profiler.Init();
+	gui.SetProfiler(&profiler);
 
-	/*
-		Render user input to texture0
-			V
-		Use user input to render next timestep to texture1
-			V
-		Render next timestep (texture1) back to texture0
-			V
-		Render texture1 to screen
-	*/
+	while (!glfwWindowShouldClose(window))
+	{
+		Trace::Zone frameZone{ "Frame" };
 
-	float invResX = 1.0f / float(resX);
-	float invResY = 1.0f / float(resY);
+		profiler.BeginFrame();
 
-	shader.Use();
-	shader.SetInt(INPUT_UNIFORM, 0);
-	shader.SetVec2("resolution", (float)resX, (float)resY);
-	shader.SetVec2("invResolution", (float)invResX, (float)invResY);
+		if (vsync == options.unlimitedSteps)
+		{
+			vsync = !options.unlimitedSteps;
+			glfwSwapInterval(vsync ? 1 : 0);
+		}
 
-	passthrough.Use();
-	passthrough.SetInt(INPUT_UNIFORM, 1);
+		double now = glfwGetTime();
+		steps = options.unlimitedSteps ? StepsForFrame(steps, now - frameStart) : (unsigned int)std::max(1, options.stepsPerFrame);
+		frameStart = now;
 
-	while (!glfwWindowShouldClose(window))
-	{
 		gui.RenderStart();
 		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		// render offscreen
-		// render to first fbo
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo); // rendering to the same framebuffer creates artifacts
-
-		// drawing code here (render circles to the screen, etc):
-		// ...
+		// the brush reads the front buffer and renders into the back buffer
+		// rendering to the same framebuffer creates artifacts
+		profiler.Begin(FrameProfiler::Pass::Brush);
 		processInput();
-		// ...
-
-		 //glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// render to second framebuffer with next timestep
-		glActiveTexture(GL_TEXTURE0);
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo2);
-
-		shader.Use();
-		shader.SetVec3("color", color.x, color.y, color.z );
-
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-		// store the calculated timestep to texture0
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-		glActiveTexture(GL_TEXTURE1);
-
-		passthrough.Use();
+		profiler.End(FrameProfiler::Pass::Brush);
 
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		profiler.Begin(FrameProfiler::Pass::Step);
+		for (unsigned int i = 0; i < steps; i++)
+		{
+			Step();
+		}
+		profiler.End(FrameProfiler::Pass::Step);
 
 		// render onscreen
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+		gui.SetStepsLastFrame(steps);
+		gui.SetGaussianFit(gaussianEngine.IsInitialised() ? &gaussianEngine.GetFit() : nullptr);
 		gui.CreateGui();
 
-		// render the texture on to the screen with a passthrough (new timestep)
-		// render texture1 (next timestep) to screen
+		// render the front buffer (new timestep) to the screen and colour it
+
+		profiler.Begin(FrameProfiler::Pass::Display);
+		display.Use();
+		display.SetVec3(displayColor, color.x, color.y, color.z);
 
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		profiler.End(FrameProfiler::Pass::Display);
 
+		profiler.Begin(FrameProfiler::Pass::Gui);
 		gui.RenderEnd();
+		profiler.End(FrameProfiler::Pass::Gui);
+
+		profiler.Begin(FrameProfiler::Pass::Swap);
 		glfwSwapBuffers(window);
+		profiler.End(FrameProfiler::Pass::Swap);
+
+		profiler.Begin(FrameProfiler::Pass::Events);
 		glfwPollEvents();
+		profiler.End(FrameProfiler::Pass::Events);
 	}
 
 	glfwTerminate();
 }
 
+double Simulation::Run(unsigned int steps)
+{
+	Trace::Zone zone{ "Simulation::Run" };
+
+	BindPipeline();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		Step();
+	}
+
+	{
+		Trace::Zone finish{ "glFinish" };
+		glFinish();
+	}
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the GPU runs behind the CPU so the budget is met by feedback on the whole frame time
+// rather than by timing the steps as they are submitted
+unsigned int Simulation::StepsForFrame(unsigned int lastSteps, double frameSeconds) const
+{
+	double budget = 1.0 / std::max(1.0f, options.targetFps);
+	if (frameSeconds <= 0.0) return lastSteps;
+
+	double scaled = lastSteps * budget / frameSeconds;
+
+	// limit the change per frame so a single slow frame does not collapse the rate
+	scaled = std::clamp(scaled, lastSteps * 0.5, lastSteps * 2.0 + 1.0);
+
+	return std::max(1u, (unsigned int)scaled);
+}
+
+void Simulation::Seed(unsigned int seed)
+{
+	std::vector<float> cells = SeedState(resX, resY, seed, uniforms.ra);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, state.FrontTexture());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resX, resY, GL_RED, GL_FLOAT, cells.data());
+}
+
+std::vector<float> Simulation::GetState() const
+{
+	std::vector<float> cells(resX * resY);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, state.FrontFbo());
+	glReadPixels(0, 0, resX, resY, GL_RED, GL_FLOAT, cells.data());
+
+	return cells;
+}
+
+void Simulation::InitBatch(const std::vector<Uniforms>& universes, bool packed)
+{
+	batchEngine.Init(shaderDir, resX, resY, StateInternalFormat(options.stateFormat), universes, packed);
+}
+
+void Simulation::SeedBatch(unsigned int seed, bool ensemble)
+{
+	batchEngine.Seed(seed, ensemble);
+}
+
+double Simulation::RunBatch(unsigned int steps)
+{
+	Trace::Zone zone{ "Simulation::RunBatch" };
+
+	glBindVertexArray(vao);
+	glViewport(0, 0, resX, resY);
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		batchEngine.Step();
+	}
+
+	{
+		Trace::Zone finish{ "glFinish" };
+		glFinish();
+	}
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<float> Simulation::GetBatchState(unsigned int universe) const
+{
+	return batchEngine.GetState(universe);
+}
+
+void Simulation::SetUniforms(const Uniforms& uniforms)
+{
+	this->uniforms = uniforms;
+
+	if (ubo != (unsigned int)-1)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Uniforms), &this->uniforms);
+	}
+}
+
+bool Simulation::Supports(StepMode stepMode) const
+{
+	if (stepMode == StepMode::Compute) return computeAvailable && std::ceil(uniforms.ra) <= ComputeEngine::MAX_RADIUS;
+	if (stepMode == StepMode::FFT) return FFTEngine::CanTransform(resX, resY);
+
+	return true;
+}
+
+void Simulation::BindPipeline()
+{
+	glBindVertexArray(vao);
+
+	// the front buffer is always bound to unit 0
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, state.FrontTexture());
+
+	glDisable(GL_DEPTH_TEST);
+
+	/*
+		Render user input from the front buffer to the back buffer, swap
+			V
+		Render the next timestep from the front buffer to the back buffer, swap
+			V
+		Render the front buffer to screen
+	*/
+
+	float invResX = 1.0f / float(resX);
+	float invResY = 1.0f / float(resY);
+
+	for (const Shader* program : { &shader, &gather })
+	{
+		program->Use();
+		program->SetInt(INPUT_UNIFORM, 0);
+		program->SetVec2("resolution", (float)resX, (float)resY);
+		program->SetVec2("invResolution", (float)invResX, (float)invResY);
+	}
+
+	display.Use();
+	display.SetInt(INPUT_UNIFORM, 0);
+}
+
+void Simulation::Step()
+{
+	Trace::Zone zone{ "Simulation::Step" };
+
+	// render the next timestep to the back buffer
+	glActiveTexture(GL_TEXTURE0);
+
+	if (uniforms.useTransitionLut)
+	{
+		if (!transitionLut.IsInitialised()) transitionLut.Init(shaderDir);
+
+		transitionLut.Update(uniforms);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, state.BackFbo());
+
+	if (options.stepMode == StepMode::FFT && Supports(StepMode::FFT))
+	{
+		if (!fftEngine.IsInitialised()) fftEngine.Init(shaderDir, resX, resY);
+
+		fftEngine.Step(uniforms, state.BackFbo());
+	}
+	else if (options.stepMode == StepMode::TapTable)
+	{
+		if (!tapTableEngine.IsInitialised()) tapTableEngine.Init(shaderDir, resX, resY);
+
+		tapTableEngine.Step(uniforms, state.BackFbo());
+	}
+	else if (options.stepMode == StepMode::Spans)
+	{
+		if (!spanEngine.IsInitialised()) spanEngine.Init(shaderDir, resX, resY);
+
+		spanEngine.Step(uniforms, state.BackFbo());
+	}
+	else if (options.stepMode == StepMode::Gaussian)
+	{
+		if (!gaussianEngine.IsInitialised()) gaussianEngine.Init(shaderDir, resX, resY);
+
+		gaussianEngine.Step(uniforms, options.gaussianTerms, state.BackFbo());
+	}
+	else if (options.stepMode == StepMode::Pyramid)
+	{
+		if (!pyramidEngine.IsInitialised()) pyramidEngine.Init(shaderDir, resX, resY);
+
+		pyramidEngine.Step(uniforms, options.pyramidLevel, state.BackFbo());
+	}
+	else if (options.stepMode == StepMode::Compute && Supports(StepMode::Compute))
+	{
+		if (!computeEngine.IsInitialised()) computeEngine.Init(shaderDir, resX, resY, StateInternalFormat(options.stateFormat));
+
+		computeEngine.Step(state.BackTexture());
+	}
+	else
+	{
+		if (options.stepMode == StepMode::Compute && !computeAvailable)
+		{
+			std::cout << "Compute shaders need OpenGL 4.3, using the fragment shader" << std::endl;
+			options.stepMode = StepMode::Fragment;
+		}
+
+		if (options.stepMode == StepMode::FFT)
+		{
+			std::cout << "The FFT needs sides without prime factors above " << FFTEngine::MAX_RADIX << ", using the fragment shader" << std::endl;
+			options.stepMode = StepMode::Fragment;
+		}
+
+		if (options.stepMode == StepMode::Fragment && options.skipEmptyTiles && TileActivity::CanSkip(uniforms))
+		{
+			if (!tileActivity.IsInitialised()) tileActivity.Init(shaderDir, fragp, resX, resY, headless);
+
+			tileActivity.Step(uniforms, options.specialiseShaders, state.BackTexture(), state.BackFbo());
+		}
+		else
+		{
+			const Shader* program = options.stepMode == StepMode::Gather ? &gather : nullptr;
+			if (program == nullptr && options.specialiseShaders) program = shaderVariants.Get(uniforms);
+			if (program == nullptr) program = &shader;
+
+			program->Use();
+
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+	}
+
+	SwapState();
+}
+
+void Simulation::SwapState()
+{
+	state.Swap();
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, state.FrontTexture());
+}
+
 void Simulation::InitGLFW()
 {
 	glfwInit();
@@ -146,11 +429,85 @@ void Simulation::InitGLFW()
 		throw std::runtime_error{ "Failed to initialize GLAD" };
 	}
 
+	GLExt::Load((GLADloadproc)glfwGetProcAddress);
+
 	glViewport(0, 0, width, height);
 
 	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); });
 }
 
+void Simulation::InitHeadless()
+{
+	// there is no window so the viewport always covers the grid
+	width = resX;
+	height = resY;
+
+#if defined(__linux__)
+	// surfaceless platform first, it needs no display server at all
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+	{
+		throw std::runtime_error{ "Could not init EGL" };
+	}
+
+	const EGLint contextAttributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// every target is an FBO so the context needs no config or surface
+	EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		throw std::runtime_error{ "Could not create a headless OpenGL context" };
+	}
+
+	eglDisplay = display;
+	eglContext = context;
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		throw std::runtime_error{ "Failed to initialize GLAD" };
+	}
+
+	GLExt::Load((GLADloadproc)eglGetProcAddress);
+#else
+	glfwInit();
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	window = glfwCreateWindow(1, 1, "SmoothLife", nullptr, nullptr);
+
+	if (window == nullptr)
+	{
+		throw std::runtime_error{ "Could not init GLFW" };
+	}
+
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		throw std::runtime_error{ "Failed to initialize GLAD" };
+	}
+
+	GLExt::Load((GLADloadproc)glfwGetProcAddress);
+#endif
+
+	glViewport(0, 0, width, height);
+}
+
 void Simulation::InitQuad()
 {
 	glGenVertexArrays(1, &vao);
@@ -181,50 +538,44 @@ void Simulation::InitQuad()
 void Simulation::InitRendering()
 {
 	// draw to texture by rendering to it
+	GLenum format = StateInternalFormat(options.stateFormat);
 
-	glGenFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-
-	glGenTextures(1, &texture0);
-	glBindTexture(GL_TEXTURE_2D, texture0);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resX, resY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	// user draws to texture0
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture0, 0);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Framebuffer is not complete" };
-
-	// Output to fbo2
-	glGenFramebuffers(1, &fbo2);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo2);
+	for (int i = 0; i < 2; i++)
+	{
+		glGenFramebuffers(1, &state.fbos[i]);
+		glBindFramebuffer(GL_FRAMEBUFFER, state.fbos[i]);
 
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
+		glGenTextures(1, &state.textures[i]);
+		glBindTexture(GL_TEXTURE_2D, state.textures[i]);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resX, resY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, resX, resY, 0, GL_RED, GL_FLOAT, nullptr);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		// the grid is a torus, gathered quads wrap around the edges
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture1, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, state.textures[i], 0);
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Framebuffer 2 is not complete" };
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "State framebuffer is not complete" };
+	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+GLenum Simulation::StateInternalFormat(StateFormat stateFormat)
+{
+	switch (stateFormat)
+	{
+	case StateFormat::RGBA32F: return GL_RGBA32F;
+	case StateFormat::R16F: return GL_R16F;
+	case StateFormat::R16: return GL_R16;
+	default: return GL_R32F;
+	}
+}
+
 void Simulation::processInput()
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -250,52 +601,59 @@ void Simulation::DrawPixels(double x, double y)
 {
 	// test code
 
+	glBindFramebuffer(GL_FRAMEBUFFER, state.BackFbo());
+
 	brush.Use();
 	brush.SetInt(INPUT_UNIFORM, 0);
-	brush.SetVec2("xy", x / (double)width, y/(double)height);
+	brush.SetVec2(brushXy, x / (double)width, y/(double)height);
 	brush.SetVec2("resolution", (float)resX, (float)resY);
 	brush.SetFloat("depth", 1.0f);
 
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	SwapState();
 }
 
 Simulation::Shader::Shader(const char* vertexPath, const char* fragmentPath)
+	: Shader(vertexPath, nullptr, fragmentPath)
+{}
+
+// geometryPath can be null
+Simulation::Shader::Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
 {
+	Trace::Zone zone{ "Shader" };
+
 	std::string vertexSource;
+	std::string geometrySource;
 	std::string fragmentSource;
-	std::ifstream vertexFile;
-	std::ifstream fragmentFile;
-
-	// enable fstream exception throwing
-	vertexFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fragmentFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
 	try
 	{
-		vertexFile.open(vertexPath);
-		fragmentFile.open(fragmentPath);
-		std::stringstream vertexStream, fragmentStream;
-
-		vertexStream << vertexFile.rdbuf();
-		fragmentStream << fragmentFile.rdbuf();
-
-		vertexFile.close();
-		fragmentFile.close();
-
-		vertexSource = vertexStream.str();
-		fragmentSource = fragmentStream.str();
+		vertexSource = ReadSource(vertexPath);
+		if (geometryPath != nullptr) geometrySource = ReadSource(geometryPath);
+		fragmentSource = ReadSource(fragmentPath);
 	}
 	catch (const std::ifstream::failure& e)
 	{
 		std::cout << "Cannot read shader files " << e.what() << std::endl;
 	}
 
+	std::string key = ProgramCache::Key({ &vertexSource, &geometrySource, &fragmentSource });
+	id = ProgramCache::Load(key);
+	if (id != 0)
+	{
+		Reflect();
+		BindTransitionLut();
+		return;
+	}
+
 	const char* vShaderSource = vertexSource.c_str();
+	const char* gShaderSource = geometrySource.c_str();
 	const char* fShaderSource = fragmentSource.c_str();
 
 	// compile shaders
 
-	unsigned int vertex, fragment;
+	unsigned int vertex, geometry = 0, fragment;
 	int success;
 	char infoLog[512];
 
@@ -311,6 +669,21 @@ Simulation::Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		std::cout << "Vertex shader compilation failed: \n" << infoLog << std::endl;
 	}
 
+	if (geometryPath != nullptr)
+	{
+		geometry = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(geometry, 1, &gShaderSource, nullptr);
+		glCompileShader(geometry);
+
+		// print compile errors
+		glGetShaderiv(geometry, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(geometry, 512, nullptr, infoLog);
+			std::cout << "Geometry shader compilation failed: \n" << infoLog << std::endl;
+		}
+	}
+
 	fragment = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment, 1, &fShaderSource, nullptr);
 	glCompileShader(fragment);
@@ -325,20 +698,234 @@ Simulation::Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
 	id = glCreateProgram();
 	glAttachShader(id, vertex);
+	if (geometryPath != nullptr) glAttachShader(id, geometry);
 	glAttachShader(id, fragment);
+	ProgramCache::Prepare(id);
 	glLinkProgram(id);
 
 	// print link errors
-	glGetShaderiv(id, GL_LINK_STATUS, &success);
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(id, 512, nullptr, infoLog);
+		glGetProgramInfoLog(id, 512, nullptr, infoLog);
 		std::cout << "Shader link failed: \n" << infoLog << std::endl;
 	}
 
 	// delete the linked shaders
 	glDeleteShader(vertex);
+	if (geometryPath != nullptr) glDeleteShader(geometry);
 	glDeleteShader(fragment);
+
+	ProgramCache::Store(id, key);
+
+	Reflect();
+	BindTransitionLut();
+}
+
+// compute shaders need GL 4.3, check GLExt::HasCompute() first
+Simulation::Shader::Shader(const char* computePath)
+{
+	Trace::Zone zone{ "Shader" };
+
+	std::string computeSource;
+
+	try
+	{
+		computeSource = ReadSource(computePath);
+	}
+	catch (const std::ifstream::failure& e)
+	{
+		std::cout << "Cannot read shader files " << e.what() << std::endl;
+	}
+
+	std::string key = ProgramCache::Key({ &computeSource });
+	id = ProgramCache::Load(key);
+	if (id != 0)
+	{
+		Reflect();
+		BindTransitionLut();
+		return;
+	}
+
+	const char* cShaderSource = computeSource.c_str();
+
+	unsigned int compute;
+	int success;
+	char infoLog[512];
+
+	compute = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(compute, 1, &cShaderSource, nullptr);
+	glCompileShader(compute);
+
+	// print compile errors
+	glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(compute, 512, nullptr, infoLog);
+		std::cout << "Compute shader compilation failed: \n" << infoLog << std::endl;
+	}
+
+	id = glCreateProgram();
+	glAttachShader(id, compute);
+	ProgramCache::Prepare(id);
+	glLinkProgram(id);
+
+	// print link errors
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(id, 512, nullptr, infoLog);
+		std::cout << "Shader link failed: \n" << infoLog << std::endl;
+	}
+
+	glDeleteShader(compute);
+
+	ProgramCache::Store(id, key);
+
+	Reflect();
+	BindTransitionLut();
+}
+
+Simulation::Shader Simulation::Shader::Build(const char* vertexPath, const char* fragmentPath, const std::string& defines)
+{
+	Trace::Zone zone{ "Shader::Build" };
+
+	std::string sources[2];
+
+	try
+	{
+		sources[0] = ReadSource(vertexPath);
+		sources[1] = ReadSource(fragmentPath);
+	}
+	catch (const std::ifstream::failure& e)
+	{
+		std::cout << "Cannot read shader files " << e.what() << std::endl;
+	}
+
+	// #version has to stay the first line
+	for (std::string& source : sources) source.insert(source.find('\n') + 1, defines);
+
+	Shader program;
+
+	// a cached binary is linked on the spot, IsLinked has nothing left to store
+	std::string key = ProgramCache::Key({ &sources[0], &sources[1] });
+	program.id = ProgramCache::Load(key);
+	if (program.id != 0) return program;
+
+	program.id = glCreateProgram();
+	program.pendingKey = key;
+
+	const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	for (int i = 0; i < 2; i++)
+	{
+		const char* source = sources[i].c_str();
+
+		unsigned int stage = glCreateShader(types[i]);
+		glShaderSource(stage, 1, &source, nullptr);
+		glCompileShader(stage);
+
+		// no status query here, that would wait for the compiler
+		glAttachShader(program.id, stage);
+		glDeleteShader(stage);
+	}
+
+	ProgramCache::Prepare(program.id);
+	glLinkProgram(program.id);
+
+	return program;
+}
+
+bool Simulation::Shader::IsFinished() const
+{
+	if (!GLExt::ParallelShaderCompile) return true;
+
+	int finished;
+	glGetProgramiv(id, GL_COMPLETION_STATUS, &finished);
+
+	return finished != 0;
+}
+
+bool Simulation::Shader::IsLinked()
+{
+	Trace::Zone zone{ "Shader::IsLinked" };
+
+	int success;
+	char infoLog[512];
+
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(id, 512, nullptr, infoLog);
+		std::cout << "Shader link failed: \n" << infoLog << std::endl;
+		return false;
+	}
+
+	if (!pendingKey.empty())
+	{
+		ProgramCache::Store(id, pendingKey);
+		pendingKey.clear();
+	}
+
+	Reflect();
+	BindTransitionLut();
+
+	return true;
+}
+
+void Simulation::Shader::Delete()
+{
+	glDeleteProgram(id);
+	id = 0;
+	reflection.reset();
+}
+
+// programs that include rules.glsl sample the lookup texture from its fixed unit
+void Simulation::Shader::BindTransitionLut() const
+{
+	UniformHandle lut = Uniform("transitionLut");
+	if (lut.index == -1) return;
+
+	int current;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+
+	glUseProgram(id);
+	SetInt(lut, TRANSITION_LUT_UNIT);
+	glUseProgram(current);
+}
+
+// reads a shader file and pastes in any #include "file" lines (relative to the including file)
+// GLSL has no include directive so shared code like the transition rules lives in its own file
+std::string Simulation::Shader::ReadSource(const std::string& path)
+{
+	std::ifstream file;
+
+	// enable fstream exception throwing
+	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	file.open(path);
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	file.close();
+
+	std::string dir = path.substr(0, path.find_last_of("/\\") + 1);
+	std::stringstream source;
+	std::string line;
+
+	while (std::getline(stream, line))
+	{
+		if (line.rfind("#include", 0) == 0)
+		{
+			size_t begin = line.find('"') + 1;
+			size_t end = line.find('"', begin);
+			source << ReadSource(dir + line.substr(begin, end - begin)) << '\n';
+		}
+		else
+		{
+			source << line << '\n';
+		}
+	}
+
+	return source.str();
 }
 
 unsigned int Simulation::Shader::GetId() const
@@ -351,47 +938,189 @@ void Simulation::Shader::Shader::Use() const
 	glUseProgram(id);
 }
 
-void Simulation::Shader::Shader::SetBool(const std::string& name, bool value) const
+Simulation::Shader::UniformHandle Simulation::Shader::Uniform(const std::string& name) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+	if (reflection == nullptr) return {};
+
+	auto found = reflection->names.find(name);
+	if (found == reflection->names.end())
+	{
+		// not listed by the driver, remember the answer (even -1) so it is only asked once
+		ActiveUniform uniform;
+		uniform.location = glGetUniformLocation(id, name.c_str());
+
+		reflection->uniforms.push_back(uniform);
+		found = reflection->names.emplace(name, (int)reflection->uniforms.size() - 1).first;
+	}
+
+	return { reflection->uniforms[found->second].location == -1 ? -1 : found->second };
+}
+
+unsigned int Simulation::Shader::UniformBlock(const std::string& name) const
+{
+	if (reflection == nullptr) return GL_INVALID_INDEX;
+
+	auto found = reflection->blocks.find(name);
+	return found == reflection->blocks.end() ? GL_INVALID_INDEX : found->second;
+}
+
+void Simulation::Shader::BindUniformBlock(const std::string& name, unsigned int binding) const
+{
+	unsigned int block = UniformBlock(name);
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(id, block, binding);
+}
+
+void Simulation::Shader::Reflect()
+{
+	reflection = std::make_shared<Reflection>();
+
+	int count = 0;
+	int maxLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(std::max(maxLength, 1));
+
+	for (int i = 0; i < count; i++)
+	{
+		int size;
+		GLenum type;
+		glGetActiveUniform(id, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+
+		// members of a uniform block have no location
+		int location = glGetUniformLocation(id, name.data());
+		if (location == -1) continue;
+
+		ActiveUniform uniform;
+		uniform.location = location;
+		reflection->uniforms.push_back(uniform);
+
+		int index = (int)reflection->uniforms.size() - 1;
+		std::string full = name.data();
+		reflection->names.emplace(full, index);
+
+		// arrays are listed as name[0] but can be set by their bare name
+		if (full.size() > 3 && full.compare(full.size() - 3, 3, "[0]") == 0) reflection->names.emplace(full.substr(0, full.size() - 3), index);
+	}
+
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+
+	name.resize(std::max(maxLength, 1));
+
+	for (int i = 0; i < count; i++)
+	{
+		glGetActiveUniformBlockName(id, i, (GLsizei)name.size(), nullptr, name.data());
+		reflection->blocks.emplace(name.data(), (unsigned int)i);
+	}
+}
+
+int Simulation::Shader::Changed(UniformHandle uniform, const void* value, size_t size) const
+{
+	if (uniform.index == -1 || reflection == nullptr) return -1;
+
+	ActiveUniform& active = reflection->uniforms[uniform.index];
+	if (active.uploaded && std::memcmp(active.value, value, size) == 0) return -1;
+
+	std::memcpy(active.value, value, size);
+	active.uploaded = true;
+
+	return active.location;
 }
 
-void Simulation::Shader::Shader::SetInt(const std::string& name, int value) const
+void Simulation::Shader::SetBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+	SetBool(Uniform(name), value);
 }
 
-void Simulation::Shader::Shader::SetFloat(const std::string& name, float value) const
+void Simulation::Shader::SetInt(const std::string& name, int value) const
 {
-	glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+	SetInt(Uniform(name), value);
 }
 
-void Simulation::Shader::Shader::SetVec4(const std::string& name, float f0, float f1, float f2, float f3) const
+void Simulation::Shader::SetFloat(const std::string& name, float value) const
 {
-	glUniform4f(glGetUniformLocation(id, name.c_str()), f0, f1, f2, f3);
+	SetFloat(Uniform(name), value);
 }
 
-void Simulation::Shader::Shader::SetVec3(const std::string& name, float f0, float f1, float f2) const
+void Simulation::Shader::SetVec4(const std::string& name, float f0, float f1, float f2, float f3) const
 {
-	glUniform3f(glGetUniformLocation(id, name.c_str()), f0, f1, f2);
+	SetVec4(Uniform(name), f0, f1, f2, f3);
 }
 
-void Simulation::Shader::Shader::SetVec2(const std::string& name, float f0, float f1) const
+void Simulation::Shader::SetVec3(const std::string& name, float f0, float f1, float f2) const
 {
-	glUniform2f(glGetUniformLocation(id, name.c_str()), f0, f1);
+	SetVec3(Uniform(name), f0, f1, f2);
 }
 
-void Simulation::Shader::Shader::SetMat4(const std::string& name, glm::mat4& mat)
+void Simulation::Shader::SetVec2(const std::string& name, float f0, float f1) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+	SetVec2(Uniform(name), f0, f1);
 }
 
-Simulation::GUIHandler::GUIHandler(GLFWwindow* window, Uniforms& uniforms, glm::vec3& color)
-	: window{window}, uniforms{uniforms}, color{color}
+void Simulation::Shader::SetIVec2(const std::string& name, int i0, int i1) const
+{
+	SetIVec2(Uniform(name), i0, i1);
+}
+
+void Simulation::Shader::SetMat4(const std::string& name, glm::mat4& mat)
+{
+	// too big for the cached value, always uploaded
+	UniformHandle uniform = Uniform(name);
+	if (uniform.index != -1) glUniformMatrix4fv(reflection->uniforms[uniform.index].location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Simulation::Shader::SetBool(UniformHandle uniform, bool value) const
+{
+	SetInt(uniform, (int)value);
+}
+
+void Simulation::Shader::SetInt(UniformHandle uniform, int value) const
+{
+	int location = Changed(uniform, &value, sizeof(value));
+	if (location != -1) glUniform1i(location, value);
+}
+
+void Simulation::Shader::SetFloat(UniformHandle uniform, float value) const
+{
+	int location = Changed(uniform, &value, sizeof(value));
+	if (location != -1) glUniform1f(location, value);
+}
+
+void Simulation::Shader::SetVec2(UniformHandle uniform, float f0, float f1) const
+{
+	const float value[] = { f0, f1 };
+	int location = Changed(uniform, value, sizeof(value));
+	if (location != -1) glUniform2f(location, f0, f1);
+}
+
+void Simulation::Shader::SetIVec2(UniformHandle uniform, int i0, int i1) const
+{
+	const int value[] = { i0, i1 };
+	int location = Changed(uniform, value, sizeof(value));
+	if (location != -1) glUniform2i(location, i0, i1);
+}
+
+void Simulation::Shader::SetVec3(UniformHandle uniform, float f0, float f1, float f2) const
+{
+	const float value[] = { f0, f1, f2 };
+	int location = Changed(uniform, value, sizeof(value));
+	if (location != -1) glUniform3f(location, f0, f1, f2);
+}
+
+void Simulation::Shader::SetVec4(UniformHandle uniform, float f0, float f1, float f2, float f3) const
+{
+	const float value[] = { f0, f1, f2, f3 };
+	int location = Changed(uniform, value, sizeof(value));
+	if (location != -1) glUniform4f(location, f0, f1, f2, f3);
+}
+
+Simulation::GUIHandler::GUIHandler(GLFWwindow* window, Uniforms& uniforms, Options& options, glm::vec3& color)
+	: window{window}, uniforms{uniforms}, options{options}, color{color}
 {}
 
-Simulation::GUIHandler::GUIHandler(Uniforms & uniforms, glm::vec3& color)
-	: uniforms{uniforms}, window{nullptr}, color{color}
+Simulation::GUIHandler::GUIHandler(Uniforms & uniforms, Options& options, glm::vec3& color)
+	: uniforms{uniforms}, window{nullptr}, options{options}, color{color}
 {}
 
 void Simulation::GUIHandler::Init()
@@ -417,9 +1146,48 @@ void Simulation::GUIHandler::RenderStart()
 
 void Simulation::GUIHandler::CreateGui()
 {
+	Trace::Zone zone{ "GUIHandler::CreateGui" };
+
 	ImGui::Begin("Properties");
 	ImGui::SetWindowSize({ 350, 600 });
 
+	const char* stepModes[] = { "Fragment shader", "FFT", "Tap table", "Texture gather", "Compute shader", "Row spans", "Gaussian mixture", "Box pyramid" };
+	int stepMode = (int)options.stepMode;
+	if (ImGui::Combo("Step mode", &stepMode, stepModes, IM_ARRAYSIZE(stepModes)))
+	{
+		options.stepMode = (StepMode)stepMode;
+	}
+
+	if (options.stepMode == StepMode::Fragment)
+	{
+		ImGui::Checkbox("Skip empty tiles", &options.skipEmptyTiles);
+		ImGui::Checkbox("Specialised shaders", &options.specialiseShaders);
+	}
+	else if (options.stepMode == StepMode::Gaussian)
+	{
+		ImGui::SliderInt("Gaussians", &options.gaussianTerms, 1, GaussianFit::MAX_TERMS);
+		if (gaussianFit != nullptr)
+		{
+			ImGui::Text("Kernel error: outer %.1f%%, inner %.1f%%", gaussianFit->outerError * 100.0f, gaussianFit->innerError * 100.0f);
+		}
+	}
+	else if (options.stepMode == StepMode::Pyramid)
+	{
+		ImGui::SliderInt("Largest level", &options.pyramidLevel, 1, PyramidEngine::MAX_LEVEL);
+	}
+
+	ImGui::Checkbox("As fast as possible", &options.unlimitedSteps);
+	if (options.unlimitedSteps)
+	{
+		ImGui::SliderFloat("Target fps", &options.targetFps, 5.0f, 144.0f, "%.0f");
+	}
+	else
+	{
+		ImGui::SliderInt("Steps per frame", &options.stepsPerFrame, 1, 64);
+	}
+	ImGui::Text("%.0f steps/s, %u per frame, %.0f fps", io->Framerate * stepsLastFrame, stepsLastFrame, io->Framerate);
+	ImGui::NewLine();
+
 	if (ImGui::InputFloat("ri", &uniforms.ri, 0.001, 0.1))
 	{
 		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(Uniforms, ri), sizeof(float), &uniforms.ri);
@@ -458,8 +1226,59 @@ void Simulation::GUIHandler::CreateGui()
 	}
 	ImGui::NewLine();
 
+	bool useTransitionLut = uniforms.useTransitionLut != 0;
+	if (ImGui::Checkbox("Transition lookup table", &useTransitionLut))
+	{
+		uniforms.useTransitionLut = useTransitionLut ? 1 : 0;
+		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(Uniforms, useTransitionLut), sizeof(int), &uniforms.useTransitionLut);
+	}
+	ImGui::NewLine();
+
+	const char* stateFormats[] = { "RGBA32F", "R32F", "R16F", "R16" };
+	ImGui::Text("State format: %s", stateFormats[(int)options.stateFormat]);
+
 	ImGui::ColorPicker3("Color", &(color.x));
 	ImGui::End();
+
+	if (profiler != nullptr)
+	{
+		ImGui::Begin("Performance");
+
+		if (ImGui::BeginTable("passes", 4))
+		{
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("");
+			ImGui::TableSetupColumn("p50 ms");
+			ImGui::TableSetupColumn("p99 ms");
+			ImGui::TableHeadersRow();
+
+			for (int i = 0; i < FrameProfiler::PASS_COUNT; i++)
+			{
+				FrameProfiler::Pass pass = (FrameProfiler::Pass)i;
+				FrameProfiler::Stats stats = profiler->GetStats(pass);
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(FrameProfiler::PASS_NAMES[i]);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(FrameProfiler::IsGpu(pass) ? "GPU" : "CPU");
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", stats.p50);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", stats.p99);
+			}
+
+			ImGui::EndTable();
+		}
+
+		// the brush only runs while the mouse is held, its numbers are from those frames
+		if (ImGui::Button("Write profile.csv")) profiler->WriteCsv("profile.csv");
+		ImGui::SameLine();
+		if (ImGui::Button("Write profile.json")) profiler->WriteJson("profile.json");
+		if (ImGui::Button("Write trace.json")) Trace::Write("trace.json");
+
+		ImGui::End();
+	}
 }
 
 void Simulation::GUIHandler::RenderEnd()
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,6 +14,7 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "imgui_stdlib.h"
+#include "Rules.h"
 
 /*
 
@@ -18,6 +25,28 @@ the texture is then rendered onto a quad
 
 class Simulation
 {
+public:
+	enum class StepMode
+	{
+		Fragment, // brute force convolution in simulation.frag
+		FFT,      // spectral convolution with cached kernel spectra
+		TapTable, // precomputed list of kernel offsets and weights
+		Gather,   // 2x2 texel quads per fetch in simulation_gather.frag
+		Compute,  // tiles staged in shared memory by simulation.comp, needs GL 4.3
+		Spans,    // row prefix sums, O(ra) fetches per cell
+		Gaussian, // approximate, both kernels as a few separable Gaussian blurs
+		Pyramid,  // the full weight part of the outer ring from a pyramid of box means
+	};
+
+	// the state only needs one channel, RGBA32F spends 16 bytes per cell where R16 needs 2
+	enum class StateFormat
+	{
+		RGBA32F,
+		R32F,
+		R16F,
+		R16, // unsigned normalised, the state is clamped to [0, 1] anyway
+	};
+
 private:
 	static constexpr float quad[] = 
 	{
@@ -34,36 +63,281 @@ private:
 	};
 
 	static constexpr const char* INPUT_UNIFORM = "textureIn";
+	// the transition lookup texture stays bound here, every program that includes rules.glsl samples it
+	static constexpr unsigned int TRANSITION_LUT_UNIT = 15;
 
 	class Shader
 	{
 	public:
 		Shader() = default;
 		Shader(const char* vertexPath, const char* fragmentPath);
+		Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath);
+		explicit Shader(const char* computePath);
+
+		// issues the compile and link with the defines pasted in after #version and returns without waiting
+		static Shader Build(const char* vertexPath, const char* fragmentPath, const std::string& defines);
+		// false while the driver still compiles in the background, always true without parallel shader compile
+		bool IsFinished() const;
+		// waits for the link, prints the log on failure
+		// a program built from source goes into the ProgramCache at this point
+		bool IsLinked();
+		void Delete();
 
 		unsigned int GetId() const;
 
 		void Use() const;
 
+		// a uniform resolved once, setting through it skips the name lookup
+		struct UniformHandle
+		{
+			int index = -1;
+		};
+
+		// names are looked up in the uniforms reflected at link time, the driver is only asked about
+		// names it did not list (array elements), an inactive uniform gives a handle the setters ignore
+		UniformHandle Uniform(const std::string& name) const;
+		// GL_INVALID_INDEX when the program has no such block
+		unsigned int UniformBlock(const std::string& name) const;
+		// does nothing when the program has no such block
+		void BindUniformBlock(const std::string& name, unsigned int binding) const;
+
+		// the program has to be current, a value the uniform already holds is not uploaded again
 		void SetBool(const std::string& name, bool value) const;
 		void SetInt(const std::string& name, int value) const;
 		void SetFloat(const std::string& name, float value) const;
 		void SetVec2(const std::string& name, float f0, float f1) const;
+		void SetIVec2(const std::string& name, int i0, int i1) const;
 		void SetVec4(const std::string& name, float f0, float f1, float f2, float f3) const;
 		void SetVec3(const std::string& name, float f0, float f1, float f2) const;
 		void SetMat4(const std::string& name, glm::mat4& mat);
 
+		void SetBool(UniformHandle uniform, bool value) const;
+		void SetInt(UniformHandle uniform, int value) const;
+		void SetFloat(UniformHandle uniform, float value) const;
+		void SetVec2(UniformHandle uniform, float f0, float f1) const;
+		void SetIVec2(UniformHandle uniform, int i0, int i1) const;
+		void SetVec4(UniformHandle uniform, float f0, float f1, float f2, float f3) const;
+		void SetVec3(UniformHandle uniform, float f0, float f1, float f2) const;
+
+	private:
+		static std::string ReadSource(const std::string& path);
+		// lists the active uniforms and blocks, has to run after a successful link
+		void Reflect();
+		void BindTransitionLut() const;
+		// the GL location, or -1 when the handle is invalid or the value is already uploaded
+		int Changed(UniformHandle uniform, const void* value, size_t size) const;
+
+	private:
+		struct ActiveUniform
+		{
+			int location = -1;
+			// the last value uploaded through a setter, the program starts with zeros but that is not relied on
+			bool uploaded = false;
+			unsigned char value[16] = {};
+		};
+
+		// shared by the copies of a Shader, they all refer to the same program
+		struct Reflection
+		{
+			std::unordered_map<std::string, int> names;
+			std::vector<ActiveUniform> uniforms;
+			std::unordered_map<std::string, unsigned int> blocks;
+		};
+
 	private:
 		unsigned int id;
+		std::shared_ptr<Reflection> reflection;
+		// ProgramCache key of a Build that still has to be stored once it linked
+		std::string pendingKey;
+	};
+
+	/*
+
+	Linked programs saved to disk with glGetProgramBinary so the next launch skips compiling.
+	A file is named after a hash of the sources and the vendor, renderer and version strings,
+	so an edited shader or a driver update just misses the cache. Anything the driver does not
+	take back (a format it dropped, a damaged file) is compiled from source and written again.
+
+	*/
+	class ProgramCache
+	{
+	public:
+		// empty turns the cache off
+		static void SetDirectory(const std::string& directory);
+
+		// the full source of every stage, after includes and defines
+		static std::string Key(std::initializer_list<const std::string*> sources);
+		// a linked program or 0 when there is no usable binary
+		static unsigned int Load(const std::string& key);
+		// has to come before glLinkProgram, some drivers only keep the binary when asked to
+		static void Prepare(unsigned int program);
+		// saves a linked program, does nothing if the link failed
+		static void Store(unsigned int program, const std::string& key);
+
+	private:
+		static bool Enabled();
+		static std::string Path(const std::string& key);
+
+	private:
+		static std::string directory;
 	};
 
-	struct Uniforms;
+	/*
+
+	Specialised copies of one program with the rules baked in as #defines (see rules.glsl),
+	so the compiler sees constant loop bounds and kernel weights.
+	A variant is built the first time its values are asked for, the caller keeps using the generic
+	program until it has linked. With parallel shader compile the driver builds it in the background,
+	a blocking cache compiles on the spot instead. Without parallel shader compile a non blocking
+	cache builds nothing, the link would stall the frame, so the generic program is used throughout.
+	The last few variants are kept so going back to earlier values does not compile again.
+
+	*/
+	class ShaderVariants
+	{
+	public:
+		ShaderVariants() = default;
+
+		// setup runs once on every variant after it linked, the variant is current at that point
+		void Init(const std::string& vertexPath, const std::string& fragmentPath, std::function<void(const Shader&)> setup, bool blocking);
+		bool IsInitialised() const { return initialised; }
+
+		// the variant for these uniforms or nullptr while it is still building (or failed to build,
+		// or cannot be built without waiting)
+		const Shader* Get(const Uniforms& uniforms);
+
+	private:
+		static constexpr size_t MAX_VARIANTS = 8;
+
+		struct Variant
+		{
+			std::string defines;
+			Shader shader;
+			bool ready = false;
+			bool failed = false;
+			unsigned int lastUse = 0;
+		};
+
+		static std::string Defines(const Uniforms& uniforms);
+
+	private:
+		bool initialised = false;
+		bool blocking = false;
+		bool enabled = false;
+
+		std::string vertp;
+		std::string fragp;
+		std::function<void(const Shader&)> setup;
+
+		std::vector<Variant> variants;
+		unsigned int uses = 0;
+
+		// the last lookup, skips formatting the defines while the uniforms stay the same
+		Uniforms lastUniforms{};
+		Variant* lastVariant = nullptr;
+	};
+
+	/*
+
+	Where the frame time goes, for the interactive loop.
+	GPU passes are wrapped in GL_TIME_ELAPSED queries, each pass has a small ring of them so a
+	result is only read once the driver says it is available and the CPU never waits on the GPU.
+	A pass whose ring is still full is simply not measured that frame.
+	CPU passes are timed with steady_clock. The last HISTORY samples of every pass are kept
+	for the p50/p99 panel and the CSV/JSON dumps.
+
+	*/
+	class FrameProfiler
+	{
+	public:
+		enum class Pass
+		{
+			// GPU
+			Brush,
+			Step,
+			Display,
+			Gui,
+			// CPU
+			Swap,
+			Events,
+			Count,
+		};
+
+		static constexpr int PASS_COUNT = (int)Pass::Count;
+		static constexpr const char* PASS_NAMES[PASS_COUNT] = { "Brush", "Step", "Display", "ImGui", "Swap buffers", "Poll events" };
+
+		struct Stats
+		{
+			float p50 = 0.0f;
+			float p99 = 0.0f;
+			size_t samples = 0;
+		};
+
+	public:
+		FrameProfiler() = default;
+
+		void Init();
+		bool IsInitialised() const { return initialised; }
+
+		// collects the queries that finished since the last frame
+		void BeginFrame();
+
+		// GPU passes go through timer queries, CPU passes through the clock
+		void Begin(Pass pass);
+		void End(Pass pass);
+
+		// over the kept samples, in milliseconds
+		Stats GetStats(Pass pass) const;
+		static bool IsGpu(Pass pass) { return pass < Pass::Swap; }
+
+		// every kept sample, one per line (frame, pass, ms) or one array per pass
+		bool WriteCsv(const std::string& path) const;
+		bool WriteJson(const std::string& path) const;
+
+	private:
+		static constexpr unsigned int RING = 8;
+		static constexpr size_t HISTORY = 600;
+
+		struct Sample
+		{
+			unsigned long long frame;
+			float ms;
+		};
+
+		struct Timeline
+		{
+			unsigned int queries[RING] = {};
+			unsigned long long queryFrames[RING] = {};
+			bool pending[RING] = {};
+			unsigned int next = 0;
+			// the slot of the open query or -1
+			int open = -1;
+
+			std::chrono::steady_clock::time_point cpuStart;
+			long long traceStart = 0;
+
+			// ring of the last HISTORY samples, oldest at head once it is full
+			std::vector<Sample> history;
+			size_t head = 0;
+		};
+
+		void Add(Timeline& timeline, unsigned long long frame, float ms);
+		// in the order they were taken
+		static std::vector<Sample> Ordered(const Timeline& timeline);
+
+	private:
+		bool initialised = false;
+		unsigned long long frame = 0;
+		Timeline timelines[PASS_COUNT];
+	} profiler;
+
+	struct Options;
 	class GUIHandler
 	{
 	public:
 		GUIHandler() = default;
-		GUIHandler(GLFWwindow* window, Uniforms& uniforms, glm::vec3& color);
-		GUIHandler(Uniforms& uniforms, glm::vec3& color);
+		GUIHandler(GLFWwindow* window, Uniforms& uniforms, Options& options, glm::vec3& color);
+		GUIHandler(Uniforms& uniforms, Options& options, glm::vec3& color);
 
 		void Init();
 		void RenderStart();
@@ -72,57 +346,573 @@ private:
 		void Shutdown();
 
 		void SetWindow(GLFWwindow* window) { this->window = window; }
+		void SetStepsLastFrame(unsigned int steps) { stepsLastFrame = steps; }
+		void SetGaussianFit(const GaussianFit* fit) { gaussianFit = fit; }
+		void SetProfiler(const FrameProfiler* profiler) { this->profiler = profiler; }
 		ImGuiIO* GetIO() const { return io; }
 
 	private:
 		GLFWwindow* window;
+		unsigned int stepsLastFrame = 0;
+		const GaussianFit* gaussianFit = nullptr;
+		const FrameProfiler* profiler = nullptr;
 		Uniforms& uniforms;
+		Options& options;
 		glm::vec3& color;
 		ImGuiIO* io = nullptr;
 	} gui;
 
+	/*
+	
+	Computes the inner and outer ring sums as a product in frequency space
+	state -> FFT -> multiply by the kernel spectrum -> inverse FFT -> transition
+
+	Both kernels are real so they are packed into a single complex kernel (outer + i * inner)
+	and the inverse transform returns both sums at once.
+	The kernel spectrum is only rebuilt when ri or ra change.
+
+	*/
+	class FFTEngine
+	{
+	public:
+		// largest radix of a pass, a radix p pass fetches p texels for every texel
+		static constexpr unsigned int MAX_RADIX = 16;
+
+		FFTEngine() = default;
+
+		// false when a side has a prime factor above MAX_RADIX, the fragment shader is cheaper then
+		static bool CanTransform(unsigned int resolutionX, unsigned int resolutionY);
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep to outFbo
+		void Step(const Uniforms& uniforms, unsigned int outFbo);
+
+	private:
+		static constexpr int STATE = -1;
+		static constexpr unsigned int WORK_UNIT = 2;
+		static constexpr unsigned int KERNEL_UNIT = 3;
+
+		struct Target
+		{
+			unsigned int texture = (unsigned int)-1;
+			unsigned int fbo = (unsigned int)-1;
+		};
+
+		static std::vector<unsigned int> Factorise(unsigned int n);
+		static Target CreateTarget(unsigned int resolutionX, unsigned int resolutionY);
+
+		void BuildKernel(float ri, float ra);
+		// runs every radix pass along one axis starting from targets[src] (or the state)
+		// returns the index of the target holding the result
+		int Transform(int src, int axis, float direction);
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+
+		std::vector<unsigned int> factorsX;
+		std::vector<unsigned int> factorsY;
+
+		Target targets[2];
+		Target kernel;
+
+		float kernelRi = -1.0f;
+		float kernelRa = -1.0f;
+
+		Shader fft{};
+		Shader multiply{};
+		Shader transition{};
+	} fftEngine;
+
+	/*
+
+	Same sums as convolve() in simulation.frag but the offsets and antialiased weights
+	of every tap inside ra are computed once on the CPU and read from a buffer texture,
+	so the loop skips the corners of the bounding square and does a fetch and a multiply add per tap.
+	The table is only rebuilt when ri or ra change.
+
+	*/
+	class TapTableEngine
+	{
+	public:
+		TapTableEngine() = default;
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep to outFbo
+		void Step(const Uniforms& uniforms, unsigned int outFbo);
+
+	private:
+		static constexpr unsigned int TAP_UNIT = 2;
+
+		void BuildTable(float ri, float ra);
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+
+		unsigned int buffer = (unsigned int)-1;
+		unsigned int texture = (unsigned int)-1;
+
+		float tableRi = -1.0f;
+		float tableRa = -1.0f;
+
+		Shader shader{};
+	} tapTableEngine;
+
+	/*
+
+	Same sums as convolve() in simulation.frag in a compute shader.
+	A work group copies its tile and the ceil(ra) wide halo around it into shared memory once,
+	every cell of the tile then convolves from shared memory instead of refetching its neighbours' texels.
+	The result is written straight into the back state texture with imageStore.
+
+	*/
+	class ComputeEngine
+	{
+	public:
+		// largest ceil(ra) the shared tile of simulation.comp holds, larger radii use the fragment shader
+		static constexpr int MAX_RADIUS = 32;
+
+		ComputeEngine() = default;
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY, GLenum stateFormat);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and writes the next timestep into outTexture
+		void Step(unsigned int outTexture);
+
+	private:
+		static constexpr unsigned int TILE = 16;
+		static constexpr unsigned int IMAGE_UNIT = 0;
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+		GLenum format = GL_R32F;
+
+		Shader shader{};
+	} computeEngine;
+
+	/*
+
+	Splits each row of the kernel into spans of constant weight.
+	A scan pass writes the prefix sums of every row of the state, padded by ceil(ra) on both sides,
+	so any span is the difference of two fetches and a cell costs O(ra) fetches instead of O(ra^2).
+	The antialiased rim cells do not have a constant weight and are read as single edge taps.
+	The span table and the prefix targets are only rebuilt when ri or ra change.
+
+	*/
+	class SpanEngine
+	{
+	public:
+		SpanEngine() = default;
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep to outFbo
+		void Step(const Uniforms& uniforms, unsigned int outFbo);
+
+	private:
+		static constexpr unsigned int PREFIX_UNIT = 2;
+		static constexpr unsigned int TABLE_UNIT = 3;
+
+		struct Target
+		{
+			unsigned int texture = (unsigned int)-1;
+			unsigned int fbo = (unsigned int)-1;
+		};
+
+		void BuildTable(float ri, float ra);
+		// prefix targets of width resX + 2 * halo + 1
+		void CreateTargets();
+		// returns the index of the target holding the prefix sums
+		int Scan();
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+		unsigned int halo = 0;
+		unsigned int prefixWidth = 0;
+
+		Target targets[2];
+
+		unsigned int buffer = (unsigned int)-1;
+		unsigned int texture = (unsigned int)-1;
+
+		float tableRi = -1.0f;
+		float tableRa = -1.0f;
+
+		Shader scan{};
+		Shader shader{};
+	} spanEngine;
+
+	/*
+
+	Approximates both kernels by weighted sums of up to four separable Gaussians (FitGaussianMixture in Rules.h).
+	Every Gaussian lives in one channel, so a step is a horizontal blur, a vertical blur and the transition,
+	O(ra) fetches per cell. More Gaussians fit the kernels better and make the blurs wider.
+	The fit is only redone when ri, ra or the number of Gaussians change.
+
+	*/
+	class GaussianEngine
+	{
+	public:
+		GaussianEngine() = default;
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep to outFbo
+		void Step(const Uniforms& uniforms, int terms, unsigned int outFbo);
+
+		const GaussianFit& GetFit() const { return fit; }
+
+	private:
+		static constexpr unsigned int WORK_UNIT = 2;
+		static constexpr unsigned int WEIGHT_UNIT = 3;
+
+		struct Target
+		{
+			unsigned int texture = (unsigned int)-1;
+			unsigned int fbo = (unsigned int)-1;
+		};
+
+		void Fit(float ri, float ra, int terms);
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+
+		Target targets[2];
+
+		unsigned int buffer = (unsigned int)-1;
+		unsigned int texture = (unsigned int)-1;
+
+		GaussianFit fit;
+		float fitRi = -1.0f;
+		float fitRa = -1.0f;
+
+		Shader blur{};
+		Shader transition{};
+	} gaussianEngine;
+
+	/*
+
+	Builds a pyramid of sliding box means every step. Every level has the full resolution and texel p
+	of level k is the mean of the 2^k x 2^k cells from p to p + 2^k - 1, four texels of level k - 1.
+	The cells of the outer annulus with the full weight are tiled by square blocks of 2^k cells a side
+	and each block is a single fetch from level k at the pixel plus the block corner,
+	so every pixel sums exactly the cells of its own blocks,
+	everything else (the inner disk, both antialiased rims and the cells the blocks leave out) is a tap.
+	Larger blocks need fewer fetches in the step but one more pass to build.
+	The table is only rebuilt when ri, ra or the largest level change.
+
+	*/
+	class PyramidEngine
+	{
+	public:
+		PyramidEngine() = default;
+
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY);
+		bool IsInitialised() const { return initialised; }
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep to outFbo
+		// blocks are at most 2^maxLevel cells a side
+		void Step(const Uniforms& uniforms, int maxLevel, unsigned int outFbo);
+
+		static constexpr int MAX_LEVEL = 6;
+
+	private:
+		static constexpr unsigned int SOURCE_UNIT = 2;
+		static constexpr unsigned int TABLE_UNIT = 3;
+		// level k is on LEVEL_UNIT + k - 1
+		static constexpr unsigned int LEVEL_UNIT = 4;
+
+		struct Target
+		{
+			unsigned int texture = (unsigned int)-1;
+			unsigned int fbo = (unsigned int)-1;
+		};
+
+		void BuildTable(float ri, float ra, int maxLevel);
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+		int levels = 0;
+
+		// level k is levelTargets[k - 1]
+		Target levelTargets[MAX_LEVEL];
+
+		unsigned int buffer = (unsigned int)-1;
+		unsigned int texture = (unsigned int)-1;
+
+		float tableRi = -1.0f;
+		float tableRa = -1.0f;
+		int tableLevel = -1;
+
+		Shader box{};
+		Shader shader{};
+	} pyramidEngine;
+
+	/*
+
+	Skips the tiles of the fragment step that would stay empty.
+	Every step reduces both state buffers to one texel per tile (is any cell of the tile alive),
+	then simulation.frag is drawn as one instanced quad per tile and tiles.vert collapses the quads
+	of tiles whose ceil(ra) neighbourhood is empty now and that are already empty in the back buffer.
+	Only valid while an empty neighbourhood stays empty, see CanSkip.
+
+	*/
+	class TileActivity
+	{
+	public:
+		TileActivity() = default;
+
+		// blocking compiles shader variants on the spot
+		void Init(const std::string& shaderDir, const std::string& simFragment, unsigned int resolutionX, unsigned int resolutionY, bool blocking);
+		bool IsInitialised() const { return initialised; }
+
+		// true when a cell with an empty neighbourhood stays empty under these rules
+		static bool CanSkip(const Uniforms& uniforms);
+
+		// reads the state from the texture bound to unit 0 and renders the next timestep of the live tiles to outFbo
+		// the back buffer has to be the texture attached to outFbo
+		// specialise draws with a ShaderVariants program once it is ready
+		void Step(const Uniforms& uniforms, bool specialise, unsigned int backTexture, unsigned int outFbo);
+
+	private:
+		static constexpr unsigned int TILE = 16;
+		static constexpr unsigned int BACK_UNIT = 2;
+		static constexpr unsigned int ACTIVITY_UNIT = 3;
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+		unsigned int tilesX = 0;
+		unsigned int tilesY = 0;
+
+		unsigned int texture = (unsigned int)-1;
+		unsigned int fbo = (unsigned int)-1;
+
+		Shader activity{};
+		Shader shader{};
+		ShaderVariants variants;
+	} tileActivity;
+
+	/*
+
+	Many independent universes stepped by one draw, for parameter sweeps.
+	The states are the layers of a texture array and every universe has its own rules in a buffer texture.
+	The quad is drawn once per universe as an instance, batch.geom routes each instance to its layer
+	and simulation_batch.frag reads the rules of that layer instead of the SimData block.
+	Always the brute force convolution with the analytic transition, like the exact fragment step.
+
+	Packed batches keep four universes in the channels of every texel (simulation_batch_packed.frag),
+	so one fetch feeds the ring sums of all four. The four universes of a texel share the kernel,
+	ri and ra have to be the same in every group of four (universes 0-3, 4-7, ...).
+
+	*/
+	class BatchEngine
+	{
+	public:
+		BatchEngine() = default;
+
+		// one layer per universe (per four packed universes), throws when there are more than GL_MAX_ARRAY_TEXTURE_LAYERS
+		// or the universes of a packed texel do not share ri and ra
+		void Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY, GLenum stateFormat, const std::vector<Uniforms>& universes, bool packed);
+		bool IsInitialised() const { return initialised; }
+
+		unsigned int GetCount() const { return (unsigned int)parameters.size(); }
+
+		// see SeedState() in Rules.h, every universe with its own ra
+		// an ensemble seeds universe i with seed + i, otherwise they all start the same
+		void Seed(unsigned int seed, bool ensemble);
+		// the next timestep of every universe, the quad has to be bound and the viewport resX x resY
+		void Step();
+		// row major resX * resY of one universe, row 0 is the bottom row
+		std::vector<float> GetState(unsigned int universe) const;
+
+	private:
+		static constexpr unsigned int PARAMETER_UNIT = 2;
+
+		static GLenum PackedFormat(GLenum stateFormat);
+
+	private:
+		bool initialised = false;
+
+		unsigned int resX = 0;
+		unsigned int resY = 0;
+		unsigned int layers = 0;
+		// universes per layer, 1 or 4
+		unsigned int channels = 1;
+
+		std::vector<Uniforms> parameters;
+
+		// ping pong like StateBuffers
+		unsigned int textures[2] = { (unsigned int)-1, (unsigned int)-1 };
+		unsigned int fbos[2] = { (unsigned int)-1, (unsigned int)-1 };
+		int front = 0;
+		// one layer at a time is attached here to read it back
+		unsigned int readFbo = (unsigned int)-1;
+
+		unsigned int buffer = (unsigned int)-1;
+		unsigned int texture = (unsigned int)-1;
+
+		Shader shader{};
+	} batchEngine;
+
+	/*
+
+	transition() only depends on the ring sums and the rules, so it is rendered once into a
+	SIZE x SIZE texture and the step shaders read it with one bilinear fetch instead of six exp().
+	The texture is only rebuilt when a parameter of the transition changes.
+
+	*/
+	class TransitionLut
+	{
+	public:
+		TransitionLut() = default;
+
+		void Init(const std::string& shaderDir);
+		bool IsInitialised() const { return initialised; }
+
+		// rebuilds the texture if alpha_m, alpha_n, b1, b2, d1 or d2 changed
+		void Update(const Uniforms& uniforms);
+
+	private:
+		static constexpr unsigned int SIZE = 1024;
+
+	private:
+		bool initialised = false;
+
+		unsigned int texture = (unsigned int)-1;
+		unsigned int fbo = (unsigned int)-1;
+
+		// the uniforms of the current texture, ri, ra and dt do not matter
+		Uniforms built{};
+		bool empty = true;
+
+		Shader shader{};
+	} transitionLut;
+
 public:
-	Simulation(const std::string& vertexShader, const std::string& simVertShader, const std::string& fragmentShader, const std::string& passthroughFrag, const std::string& brushFrag, unsigned int resolutionX, unsigned int resolutionY, unsigned int windowWidth, unsigned int windowHeight);
+	// a headless simulation renders offscreen only, there is no window, swap chain or GUI
+	Simulation(const std::string& vertexShader, const std::string& simVertShader, const std::string& fragmentShader, const std::string& brushFrag, unsigned int resolutionX, unsigned int resolutionY, unsigned int windowWidth, unsigned int windowHeight, bool headless = false);
+	~Simulation();
 
 	void Init();
 	void MainLoop();
 
+	// headless: runs the given number of timesteps back to back and returns the elapsed seconds
+	double Run(unsigned int steps);
+
+	// see SeedState() in Rules.h
+	void Seed(unsigned int seed);
+	// row major resX * resY, row 0 is the bottom row
+	std::vector<float> GetState() const;
+
+	// a batch of independent universes at the resolution of the simulation, one per set of rules (see BatchEngine)
+	// has to come after Init
+	// packed keeps four universes per texel, see BatchEngine
+	void InitBatch(const std::vector<Uniforms>& universes, bool packed = false);
+	void SeedBatch(unsigned int seed, bool ensemble = false);
+	// runs the given number of timesteps of every universe and returns the elapsed seconds
+	double RunBatch(unsigned int steps);
+	std::vector<float> GetBatchState(unsigned int universe) const;
+
+	void SetUniforms(const Uniforms& uniforms);
+	void SetStepMode(StepMode stepMode) { options.stepMode = stepMode; }
+	// false when the step would fall back to the fragment shader with the current rules, has to come after Init
+	// compute needs OpenGL 4.3 and ceil(ra) <= ComputeEngine::MAX_RADIUS, fft needs FFTEngine::CanTransform()
+	bool Supports(StepMode stepMode) const;
+	// number of Gaussians of StepMode::Gaussian, 1 to GaussianFit::MAX_TERMS
+	void SetGaussianTerms(int terms) { options.gaussianTerms = terms; }
+	// largest pyramid level of StepMode::Pyramid, 1 to PyramidEngine::MAX_LEVEL
+	void SetPyramidLevel(int level) { options.pyramidLevel = level; }
+	// lets the fragment step skip tiles that stay empty
+	void SetSkipEmptyTiles(bool skip) { options.skipEmptyTiles = skip; }
+	// lets the fragment step use programs with the rules baked in, see ShaderVariants
+	void SetSpecialiseShaders(bool specialise) { options.specialiseShaders = specialise; }
+	// where linked programs are cached between runs, empty turns the cache off, has to be set before Init
+	static void SetProgramCache(const std::string& directory) { ProgramCache::SetDirectory(directory); }
+	// has to be set before Init
+	void SetStateFormat(StateFormat stateFormat) { options.stateFormat = stateFormat; }
+
 private:
 	void InitGLFW();
+	// creates a context without a window, EGL on Linux (works under Mesa llvmpipe) and a hidden GLFW window elsewhere
+	void InitHeadless();
 	void InitQuad();
 	void InitRendering();
+	static GLenum StateInternalFormat(StateFormat stateFormat);
 	void processInput();
 
+	void BindPipeline();
+	// picks the number of timesteps for the next frame from the length of the last one
+	unsigned int StepsForFrame(unsigned int lastSteps, double frameSeconds) const;
+	// renders the next timestep of the front buffer into the back buffer and swaps them
+	void Step();
+	void SwapState();
+
 	void DrawPixels(double x, double y);
 
 private:
-	struct Uniforms
+	Uniforms uniforms;
+
+	struct Options
 	{
-		float ri = 3.0f;
-		float ra = 13.0f;
-		float dt = 0.4f;
-		float alpha_m = 0.147f;
+		StepMode stepMode = StepMode::Fragment;
+		StateFormat stateFormat = StateFormat::R32F;
+
+		// fixed number of timesteps between presents
+		int stepsPerFrame = 1;
+		// as many timesteps as fit into the frame time of targetFps, vsync is turned off
+		bool unlimitedSteps = false;
+		float targetFps = 30.0f;
 
-		float alpha_n = 0.028f;
-		float b1 = 0.261f;
-		float b2 = 0.312f;
-		float d1 = 0.327f;
+		int gaussianTerms = 3;
+		int pyramidLevel = 3;
 
-		float d2 = 0.544f;
-	} uniforms;
+		bool skipEmptyTiles = true;
+		bool specialiseShaders = true;
+	} options;
 
 	glm::vec3 color{ 92.0f/255.0f ,176.0f / 255.0f ,255.0f / 255.0f };
 
 private:
 	std::string vertp;
 	std::string fragp;
-	std::string passp;
 	std::string brushp;
 	std::string simvp;
+	std::string shaderDir;
 
 	Shader shader{};
-	Shader passthrough{};
+	ShaderVariants shaderVariants;
+	Shader gather{};
 	Shader brush{};
+	Shader display{};
+	Shader::UniformHandle displayColor;
+	Shader::UniformHandle brushXy;
 
 	unsigned int resX;
 	unsigned int resY;
@@ -134,12 +924,30 @@ private:
 	unsigned int vbo = (unsigned int)-1;
 	unsigned int ebo = (unsigned int)-1;
 
-	unsigned int texture0 = (unsigned int)-1;
-	unsigned int fbo = (unsigned int)-1;
-	unsigned int fbo2 = (unsigned int)-1;
-	unsigned int texture1 = (unsigned int)-1;
+	// double buffered state, every pass reads the front buffer and renders into the back buffer
+	// swapping replaces copying the result back
+	struct StateBuffers
+	{
+		unsigned int textures[2] = { (unsigned int)-1, (unsigned int)-1 };
+		unsigned int fbos[2] = { (unsigned int)-1, (unsigned int)-1 };
+		int front = 0;
+
+		unsigned int FrontTexture() const { return textures[front]; }
+		unsigned int FrontFbo() const { return fbos[front]; }
+		unsigned int BackFbo() const { return fbos[1 - front]; }
+		unsigned int BackTexture() const { return textures[1 - front]; }
+		void Swap() { front = 1 - front; }
+	} state;
 
 	unsigned int ubo = (unsigned int)-1;
 
+	bool headless;
+	// GL 4.3 compute shaders, StepMode::Compute falls back to the fragment shader without them
+	bool computeAvailable = false;
+
 	GLFWwindow* window = nullptr;
+
+	// EGLDisplay and EGLContext of a headless context
+	void* eglDisplay = nullptr;
+	void* eglContext = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "Simulation.h"
+#include <stdexcept>
+#include <map>
+#include <utility>
+
+void Simulation::SpanEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+
+	std::string vert = shaderDir + "default.vert";
+	scan = Shader{ vert.c_str(), (shaderDir + "span_scan.frag").c_str() };
+	shader = Shader{ vert.c_str(), (shaderDir + "simulation_spans.frag").c_str() };
+
+	shader.BindUniformBlock("SimData", 0);
+
+	scan.Use();
+	scan.SetInt("resolutionX", (int)resX);
+
+	shader.Use();
+	shader.SetInt(INPUT_UNIFORM, 0);
+	shader.SetInt("prefix", PREFIX_UNIT);
+	shader.SetInt("table", TABLE_UNIT);
+	shader.SetVec2("resolution", (float)resX, (float)resY);
+
+	glGenBuffers(1, &buffer);
+	glGenTextures(1, &texture);
+
+	initialised = true;
+}
+
+void Simulation::SpanEngine::Step(const Uniforms& uniforms, unsigned int outFbo)
+{
+	if (uniforms.ri != tableRi || uniforms.ra != tableRa)
+	{
+		BuildTable(uniforms.ri, uniforms.ra);
+	}
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glViewport(0, 0, prefixWidth, resY);
+	int cur = Scan();
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glActiveTexture(GL_TEXTURE0 + PREFIX_UNIT);
+	glBindTexture(GL_TEXTURE_2D, targets[cur].texture);
+	glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	shader.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+int Simulation::SpanEngine::Scan()
+{
+	scan.Use();
+
+	// the first pass reads the state straight from unit 0
+	scan.SetBool("fromState", true);
+	scan.SetInt(INPUT_UNIFORM, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targets[0].fbo);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	scan.SetBool("fromState", false);
+	scan.SetInt(INPUT_UNIFORM, PREFIX_UNIT);
+
+	int src = 0;
+	for (unsigned int offset = 1; offset < prefixWidth; offset *= 2)
+	{
+		int dst = 1 - src;
+
+		glActiveTexture(GL_TEXTURE0 + PREFIX_UNIT);
+		glBindTexture(GL_TEXTURE_2D, targets[src].texture);
+
+		scan.SetInt("offset", (int)offset);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, targets[dst].fbo);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+		src = dst;
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+
+	return src;
+}
+
+void Simulation::SpanEngine::CreateTargets()
+{
+	prefixWidth = resX + 2 * halo + 1;
+
+	// keep unit 0 (the state) untouched
+	glActiveTexture(GL_TEXTURE0 + PREFIX_UNIT);
+
+	for (Target& target : targets)
+	{
+		if (target.fbo == (unsigned int)-1)
+		{
+			glGenFramebuffers(1, &target.fbo);
+			glGenTextures(1, &target.texture);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+		glBindTexture(GL_TEXTURE_2D, target.texture);
+
+		// full float precision, the sums grow to the width of the grid
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, prefixWidth, resY, 0, GL_RED, GL_FLOAT, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Span framebuffer is not complete" };
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+
+	scan.Use();
+	scan.SetInt("halo", (int)halo);
+
+	shader.Use();
+	shader.SetInt("halo", (int)halo);
+}
+
+// same weights as convolve() in simulation.frag
+void Simulation::SpanEngine::BuildTable(float ri, float ra)
+{
+	unsigned int newHalo = (unsigned int)std::ceil(ra);
+	if (newHalo > resX || newHalo > resY) throw std::runtime_error{ "ra is larger than the grid" };
+
+	if (newHalo != halo || targets[0].fbo == (unsigned int)-1)
+	{
+		halo = newHalo;
+		CreateTargets();
+	}
+
+	std::vector<KernelTap> kernelTaps = BuildKernelTaps(ri, ra);
+
+	// the weight of the cells away from the rim, the same for every cell of a ring
+	float full[2] = { 0.0f, 0.0f };
+	for (const KernelTap& tap : kernelTaps)
+	{
+		float& w = full[tap.inner ? 1 : 0];
+		w = std::max(w, tap.weight);
+	}
+
+	// (outer, inner) weight of every cell in the bounding square
+	int r = (int)halo;
+	int side = 2 * r + 1;
+	std::vector<std::pair<float, float>> weights(side * side, { 0.0f, 0.0f });
+
+	for (const KernelTap& tap : kernelTaps)
+	{
+		std::pair<float, float>& w = weights[(tap.y + r) * side + tap.x + r];
+		(tap.inner ? w.second : w.first) += tap.weight;
+	}
+
+	auto core = [&full](float w, int ring) { return w == full[ring] ? w : 0.0f; };
+
+	// a row of constant weights c(dx), symmetric in dx, is the sum over k of (c(k) - c(k + 1)) * [|dx| <= k]
+	// so every change of weight along the row starts a span of half width k
+	std::map<std::pair<int, int>, std::pair<float, float>> spans;
+	std::map<std::pair<int, int>, std::pair<float, float>> taps;
+
+	for (int y = -r; y <= r; y++)
+	{
+		const std::pair<float, float>* row = &weights[(y + r) * side + r];
+
+		for (int k = 0; k <= r; k++)
+		{
+			std::pair<float, float> next = k < r ? row[k + 1] : std::pair<float, float>{ 0.0f, 0.0f };
+
+			float outer = core(row[k].first, 0) - core(next.first, 0);
+			float inner = core(row[k].second, 1) - core(next.second, 1);
+
+			if (outer != 0.0f || inner != 0.0f) spans[{ k, y }] = { outer, inner };
+		}
+
+		// whatever the spans leave out is the antialiased rim
+		for (int x = -r; x <= r; x++)
+		{
+			float outer = row[x].first - core(row[x].first, 0);
+			float inner = row[x].second - core(row[x].second, 1);
+
+			if (outer != 0.0f || inner != 0.0f) taps[{ x, y }] = { outer, inner };
+		}
+	}
+
+	std::vector<float> table;
+	table.reserve((spans.size() + taps.size()) * 4);
+
+	for (const auto& entry : { &spans, &taps })
+	{
+		for (const auto& [offset, w] : *entry)
+		{
+			table.push_back((float)offset.first);
+			table.push_back((float)offset.second);
+			table.push_back(w.first);
+			table.push_back(w.second);
+		}
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(float), table.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + TABLE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.Use();
+	shader.SetInt("spanCount", (int)spans.size());
+	shader.SetInt("totalCount", (int)(spans.size() + taps.size()));
+
+	tableRi = ri;
+	tableRa = ra;
+}
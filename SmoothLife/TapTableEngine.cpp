@@ -0,0 +1,73 @@
+#include "Simulation.h"
+#include <algorithm>
+
+void Simulation::TapTableEngine::Init(const std::string& shaderDir, unsigned int resolutionX, unsigned int resolutionY)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+
+	shader = Shader{ (shaderDir + "default.vert").c_str(), (shaderDir + "simulation_taps.frag").c_str() };
+
+	shader.BindUniformBlock("SimData", 0);
+
+	shader.Use();
+	shader.SetInt(INPUT_UNIFORM, 0);
+	shader.SetInt("taps", TAP_UNIT);
+
+	glGenBuffers(1, &buffer);
+	glGenTextures(1, &texture);
+
+	initialised = true;
+}
+
+void Simulation::TapTableEngine::Step(const Uniforms& uniforms, unsigned int outFbo)
+{
+	if (uniforms.ri != tableRi || uniforms.ra != tableRa)
+	{
+		BuildTable(uniforms.ri, uniforms.ra);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + TAP_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	shader.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+void Simulation::TapTableEngine::BuildTable(float ri, float ra)
+{
+	std::vector<KernelTap> kernelTaps = BuildKernelTaps(ri, ra);
+
+	// inner taps first so each ring is one contiguous loop in the shader
+	std::stable_partition(kernelTaps.begin(), kernelTaps.end(), [](const KernelTap& tap) { return tap.inner; });
+	int innerTaps = (int)std::count_if(kernelTaps.begin(), kernelTaps.end(), [](const KernelTap& tap) { return tap.inner; });
+
+	std::vector<float> table;
+	table.reserve(kernelTaps.size() * 4);
+
+	for (const KernelTap& tap : kernelTaps)
+	{
+		table.push_back(tap.x / float(resX));
+		table.push_back(tap.y / float(resY));
+		table.push_back(tap.weight);
+		table.push_back(0.0f);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, table.size() * sizeof(float), table.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glActiveTexture(GL_TEXTURE0 + TAP_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.Use();
+	shader.SetInt("innerTaps", innerTaps);
+	shader.SetInt("totalTaps", (int)kernelTaps.size());
+
+	tableRi = ri;
+	tableRa = ra;
+}
@@ -0,0 +1,80 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <string>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 1; i < threads; i++)
+	{
+		workers.emplace_back(&ThreadPool::Work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Run(unsigned int count, const std::function<void(unsigned int)>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		this->task = &task;
+		taskCount = count;
+		nextTask = 0;
+		busy = (unsigned int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	Drain();
+
+	std::unique_lock<std::mutex> lock{ mutex };
+	done.wait(lock, [this] { return busy == 0; });
+	this->task = nullptr;
+}
+
+void ThreadPool::Work(unsigned int index)
+{
+	Trace::SetThreadName("Worker " + std::to_string(index));
+
+	unsigned long long seen = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+
+			if (stopping) return;
+			seen = generation;
+		}
+
+		Drain();
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		if (--busy == 0) done.notify_one();
+	}
+}
+
+void ThreadPool::Drain()
+{
+	Trace::Zone zone{ "ThreadPool::Drain" };
+
+	for (unsigned int i = nextTask++; i < taskCount; i = nextTask++)
+	{
+		(*task)(i);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/*
+
+Persistent worker threads for the native step implementations
+Run() hands out task indices until they are used up, the calling thread helps out
+
+*/
+
+class ThreadPool
+{
+public:
+	// 0 uses every hardware thread
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// calls task(i) for every i in [0, count) and blocks until all of them are done
+	void Run(unsigned int count, const std::function<void(unsigned int)>& task);
+
+	unsigned int GetThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+private:
+	void Work(unsigned int index);
+	void Drain();
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(unsigned int)>* task = nullptr;
+	unsigned int taskCount = 0;
+	std::atomic<unsigned int> nextTask{ 0 };
+
+	unsigned int busy = 0;
+	unsigned long long generation = 0;
+	bool stopping = false;
+};
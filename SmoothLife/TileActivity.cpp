@@ -0,0 +1,102 @@
+#include "Simulation.h"
+#include <stdexcept>
+
+void Simulation::TileActivity::Init(const std::string& shaderDir, const std::string& simFragment, unsigned int resolutionX, unsigned int resolutionY, bool blocking)
+{
+	resX = resolutionX;
+	resY = resolutionY;
+	tilesX = (resX + TILE - 1) / TILE;
+	tilesY = (resY + TILE - 1) / TILE;
+
+	activity = Shader{ (shaderDir + "default.vert").c_str(), (shaderDir + "tile_activity.frag").c_str() };
+	shader = Shader{ (shaderDir + "tiles.vert").c_str(), simFragment.c_str() };
+
+	activity.Use();
+	activity.SetInt("front", 0);
+	activity.SetInt("back", BACK_UNIT);
+	activity.SetInt("tileSize", TILE);
+	activity.SetIVec2("resolution", (int)resX, (int)resY);
+
+	auto setup = [this](const Shader& program)
+	{
+		program.BindUniformBlock("SimData", 0);
+
+		program.SetInt(INPUT_UNIFORM, 0);
+		program.SetInt("activity", ACTIVITY_UNIT);
+		program.SetIVec2("tiles", (int)tilesX, (int)tilesY);
+		program.SetInt("tileSize", TILE);
+		program.SetVec2("resolution", (float)resX, (float)resY);
+		program.SetVec2("invResolution", 1.0f / float(resX), 1.0f / float(resY));
+	};
+
+	shader.Use();
+	setup(shader);
+
+	variants.Init(shaderDir + "tiles.vert", simFragment, setup, blocking);
+
+	// keep unit 0 (the state) untouched
+	glActiveTexture(GL_TEXTURE0 + ACTIVITY_UNIT);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, tilesX, tilesY, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Tile activity framebuffer is not complete" };
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	initialised = true;
+}
+
+// an empty neighbourhood gives v = 0 and f = (0, 0), the cell stays at 0 unless the transition pushes it up
+bool Simulation::TileActivity::CanSkip(const Uniforms& uniforms)
+{
+	return Transition(uniforms, 0.0f, 0.0f) <= 0.5f;
+}
+
+void Simulation::TileActivity::Step(const Uniforms& uniforms, bool specialise, unsigned int backTexture, unsigned int outFbo)
+{
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	// the back buffer is read here and only rendered to afterwards
+	glActiveTexture(GL_TEXTURE0 + BACK_UNIT);
+	glBindTexture(GL_TEXTURE_2D, backTexture);
+
+	glViewport(0, 0, tilesX, tilesY);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	activity.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0 + ACTIVITY_UNIT);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glActiveTexture(GL_TEXTURE0);
+
+	// a partial tile at the edge of the grid covers fewer cells so wrapping past it needs one more tile
+	bool partial = resX % TILE != 0 || resY % TILE != 0;
+	int tileRadius = (int)std::ceil(uniforms.ra / float(TILE)) + (partial ? 1 : 0);
+
+	const Shader* program = specialise ? variants.Get(uniforms) : nullptr;
+	if (program == nullptr) program = &shader;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+	program->Use();
+	program->SetInt("tileRadius", tileRadius);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, tilesX * tilesY);
+}
@@ -0,0 +1,169 @@
+#include "Trace.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+	// the fields are atomic only so Write can read them while the owner keeps recording
+	struct Event
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<long long> start{ 0 };
+		std::atomic<long long> end{ 0 };
+	};
+
+	struct Buffer
+	{
+		unsigned int tid = 0;
+		// guarded by the registry mutex
+		std::string name;
+
+		// events published so far, the newest is at (written - 1) % CAPACITY
+		std::atomic<unsigned long long> written{ 0 };
+		Event events[Trace::CAPACITY];
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+		// never freed, a thread can exit before its zones are written out
+		std::vector<std::unique_ptr<Buffer>> buffers;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local Buffer* localBuffer = nullptr;
+
+	// the only lock on the recording side, once per thread
+	Buffer& GetBuffer()
+	{
+		if (localBuffer == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock{ registry.mutex };
+
+			registry.buffers.push_back(std::make_unique<Buffer>());
+			localBuffer = registry.buffers.back().get();
+			localBuffer->tid = (unsigned int)registry.buffers.size();
+			localBuffer->name = "Thread " + std::to_string(localBuffer->tid);
+		}
+
+		return *localBuffer;
+	}
+
+	void WriteString(std::ostream& out, const std::string& text)
+	{
+		out << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') out << '\\';
+			out << c;
+		}
+		out << '"';
+	}
+}
+
+void Trace::SetThreadName(const std::string& name)
+{
+	Buffer& buffer = GetBuffer();
+
+	std::lock_guard<std::mutex> lock{ GetRegistry().mutex };
+	buffer.name = name;
+}
+
+long long Trace::Now()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(const char* name, long long start, long long end)
+{
+	Buffer& buffer = GetBuffer();
+
+	unsigned long long index = buffer.written.load(std::memory_order_relaxed);
+	Event& event = buffer.events[index % CAPACITY];
+
+	// pairs with the acquire fence in Write, a reader that sees any of the new fields also sees written >= index
+	std::atomic_thread_fence(std::memory_order_release);
+
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+bool Trace::Write(const std::string& path)
+{
+	struct Copy
+	{
+		const char* name;
+		long long start;
+		long long end;
+	};
+
+	std::ofstream file{ path };
+	if (!file) return false;
+
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	auto separator = [&file, &first]()
+	{
+		if (!first) file << ",\n";
+		first = false;
+	};
+
+	for (const std::unique_ptr<Buffer>& buffer : registry.buffers)
+	{
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+		WriteString(file, buffer->name);
+		file << "}}";
+
+		unsigned long long written = buffer->written.load(std::memory_order_acquire);
+		unsigned long long begin = written > CAPACITY ? written - CAPACITY : 0;
+
+		std::vector<Copy> events;
+		events.reserve(written - begin);
+
+		for (unsigned long long i = begin; i < written; i++)
+		{
+			const Event& event = buffer->events[i % CAPACITY];
+			events.push_back({ event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) });
+		}
+
+		// the owner may have wrapped around onto the oldest slots while they were copied
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long now = buffer->written.load(std::memory_order_relaxed);
+		unsigned long long valid = now >= CAPACITY ? now - CAPACITY + 1 : 0;
+
+		for (unsigned long long i = std::max(begin, valid); i < written; i++)
+		{
+			const Copy& event = events[i - begin];
+
+			separator();
+			file << "{\"name\":";
+			WriteString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+				<< ",\"ts\":" << event.start / 1000 << '.' << event.start % 1000 / 100
+				<< ",\"dur\":" << (event.end - event.start) / 1000 << '.' << (event.end - event.start) % 1000 / 100 << '}';
+		}
+	}
+
+	file << "\n]}\n";
+
+	return (bool)file;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+/*
+
+Always on timeline of scoped zones, written out as Chrome trace JSON
+(chrome://tracing or ui.perfetto.dev).
+
+Every thread records into its own ring buffer, so recording takes no lock and never
+allocates after the first zone of a thread. Only the last CAPACITY zones per thread are
+kept. Write() can run at any time from any thread, zones that get overwritten while it
+copies are left out.
+
+Names are not copied, they have to outlive the trace (string literals).
+
+*/
+
+class Trace
+{
+public:
+	static constexpr size_t CAPACITY = 1 << 14;
+
+	// records the time from construction to destruction
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name) : name{ name }, start{ Now() } {}
+		~Zone() { Record(name, start, Now()); }
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		long long start;
+	};
+
+	// shown as the name of the calling thread's track
+	static void SetThreadName(const std::string& name);
+
+	static bool Write(const std::string& path);
+
+	// for spans that do not fit a scope, Now() is in nanoseconds since the first call
+	static long long Now();
+	static void Record(const char* name, long long start, long long end);
+};
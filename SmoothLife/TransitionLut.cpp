@@ -0,0 +1,62 @@
+#include "Simulation.h"
+#include <stdexcept>
+
+void Simulation::TransitionLut::Init(const std::string& shaderDir)
+{
+	shader = Shader{ (shaderDir + "default.vert").c_str(), (shaderDir + "transition_lut.frag").c_str() };
+
+	shader.BindUniformBlock("SimData", 0);
+
+	shader.Use();
+	shader.SetVec2("size", (float)SIZE, (float)SIZE);
+
+	glActiveTexture(GL_TEXTURE0 + TRANSITION_LUT_UNIT);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SIZE, SIZE, 0, GL_RED, GL_FLOAT, nullptr);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) throw std::runtime_error{ "Transition lookup framebuffer is not complete" };
+
+	// stays bound for every step shader
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	initialised = true;
+}
+
+void Simulation::TransitionLut::Update(const Uniforms& uniforms)
+{
+	bool changed = empty
+		|| uniforms.alpha_m != built.alpha_m || uniforms.alpha_n != built.alpha_n
+		|| uniforms.b1 != built.b1 || uniforms.b2 != built.b2
+		|| uniforms.d1 != built.d1 || uniforms.d2 != built.d2;
+
+	if (!changed) return;
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glViewport(0, 0, SIZE, SIZE);
+
+	// the lookup texture is not sampled while it is rendered, transition_lut.frag only calls transitionAnalytic()
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	shader.Use();
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	built = uniforms;
+	empty = false;
+}
@@ -1,12 +1,542 @@
 #include "Simulation.h"
+#include "CpuEngine.h"
+#include "EnsembleEngine.h"
+#include "QuantizedEngine.h"
+#include "CpuKernels.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <functional>
 
-int main()
+/*
+
+SmoothLife                      interactive window
+SmoothLife --cpu [options]      runs the native engine without a GPU
+SmoothLife --headless [options] runs the shaders offscreen without a window or GUI
+SmoothLife --validate [options] compares --mode against the exact fragment shader on seeds 1, 2 and 3, at ra and ra + 0.5
+SmoothLife --quantized [options] compares the 16 and 8 bit native engines against the exact fragment shader on seeds 1, 2 and 3
+SmoothLife --batch [options]    steps --universes independent universes with swept rules in one draw per timestep
+SmoothLife --cpu-batch [options] the same batch on the native engine, one universe per SIMD lane
+
+	--size W H       grid resolution (1280 720)
+	--steps N        number of timesteps (1000)
+	--threads T      worker threads of the CPU engines, 0 = all (0)
+	--bits B         cells of the native engine, 32 (float), 16 or 8 (fixed point) (32)
+	--mode M         step mode of the headless run, fragment, fft, taps, gather, compute, spans, gaussian or pyramid (fragment)
+	--gaussians N    number of Gaussians of the gaussian mode, 1 to 4 (3)
+	--levels N       largest pyramid level of the pyramid mode, 1 to 6 (3)
+	--skip-empty B   1 lets the fragment mode skip tiles that stay empty, 0 steps every cell (1)
+	--lut B          1 reads the transition from a lookup texture, 0 evaluates it in every shader (1)
+	--specialise B   1 lets the fragment mode compile the rules into the shader, 0 reads them from the uniform block (1)
+	--shader-cache D directory of the linked program cache, none turns it off (./shader_cache/)
+	--format F       state texture of the headless run, rgba32f, r32f, r16f or r16 (r32f)
+	--seed S         seed of the random start (1)
+	--out FILE       writes the final state as raw float32, row major, the universes of a batch one after another
+	--trace FILE     writes the zones of the run as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+	--universes N    number of universes of the batch (16)
+	--sweep P A B    spreads rule P linearly from A (first universe) to B (last universe), can be repeated
+	--packed B       1 keeps four universes per texel, ri and ra have to match in every group of four (0)
+	--ensemble B     1 seeds universe i with seed + i, 0 starts every universe from the same seed (0)
+	--ri, --ra, --dt, --alpha_m, --alpha_n, --b1, --b2, --d1, --d2 VALUE
+
+The native engines use the widest SIMD path the CPU supports,
+SMOOTHLIFE_ISA=scalar|sse2|avx2|avx512 in the environment forces one.
+
+*/
+
+struct RunOptions
+{
+	unsigned int resX = 1280;
+	unsigned int resY = 720;
+	unsigned int steps = 1000;
+	unsigned int threads = 0;
+	unsigned int bits = 32;
+	unsigned int seed = 1;
+	int gaussianTerms = 3;
+	int pyramidLevel = 3;
+	bool skipEmptyTiles = true;
+	bool specialiseShaders = true;
+	Simulation::StepMode stepMode = Simulation::StepMode::Fragment;
+	Simulation::StateFormat stateFormat = Simulation::StateFormat::R32F;
+	std::string out;
+	std::string trace;
+	Uniforms uniforms;
+
+	unsigned int universes = 16;
+	bool packed = false;
+	bool ensemble = false;
+
+	struct Sweep
+	{
+		std::string name;
+		float from;
+		float to;
+	};
+	std::vector<Sweep> sweeps;
+};
+
+// nullptr for an unknown name
+static float Uniforms::* UniformField(const std::string& name)
+{
+	static const std::pair<const char*, float Uniforms::*> fields[] =
+	{
+		{ "ri", &Uniforms::ri }, { "ra", &Uniforms::ra }, { "dt", &Uniforms::dt },
+		{ "alpha_m", &Uniforms::alpha_m }, { "alpha_n", &Uniforms::alpha_n },
+		{ "b1", &Uniforms::b1 }, { "b2", &Uniforms::b2 }, { "d1", &Uniforms::d1 }, { "d2", &Uniforms::d2 },
+	};
+
+	for (const auto& field : fields)
+	{
+		if (name == field.first) return field.second;
+	}
+
+	return nullptr;
+}
+
+static bool SetUniform(Uniforms& uniforms, const std::string& name, float value)
+{
+	float Uniforms::* field = UniformField(name);
+	if (field == nullptr) return false;
+
+	uniforms.*field = value;
+	return true;
+}
+
+static bool ParseOptions(int argc, char** argv, RunOptions& options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--size" && i + 2 < argc)
+		{
+			options.resX = std::atoi(argv[++i]);
+			options.resY = std::atoi(argv[++i]);
+		}
+		else if (arg == "--steps" && hasValue) options.steps = std::atoi(argv[++i]);
+		else if (arg == "--threads" && hasValue) options.threads = std::atoi(argv[++i]);
+		else if (arg == "--bits" && hasValue)
+		{
+			options.bits = std::atoi(argv[++i]);
+			if (options.bits != 32 && options.bits != 16 && options.bits != 8)
+			{
+				std::cout << "Cells have 32, 16 or 8 bits, not " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--seed" && hasValue) options.seed = std::atoi(argv[++i]);
+		else if (arg == "--gaussians" && hasValue) options.gaussianTerms = std::atoi(argv[++i]);
+		else if (arg == "--levels" && hasValue) options.pyramidLevel = std::atoi(argv[++i]);
+		else if (arg == "--skip-empty" && hasValue) options.skipEmptyTiles = std::atoi(argv[++i]) != 0;
+		else if (arg == "--specialise" && hasValue) options.specialiseShaders = std::atoi(argv[++i]) != 0;
+		else if (arg == "--lut" && hasValue) options.uniforms.useTransitionLut = std::atoi(argv[++i]) != 0 ? 1 : 0;
+		else if (arg == "--out" && hasValue) options.out = argv[++i];
+		else if (arg == "--trace" && hasValue) options.trace = argv[++i];
+		else if (arg == "--universes" && hasValue) options.universes = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--packed" && hasValue) options.packed = std::atoi(argv[++i]) != 0;
+		else if (arg == "--ensemble" && hasValue) options.ensemble = std::atoi(argv[++i]) != 0;
+		else if (arg == "--sweep" && i + 3 < argc)
+		{
+			RunOptions::Sweep sweep{ argv[i + 1], (float)std::atof(argv[i + 2]), (float)std::atof(argv[i + 3]) };
+
+			if (UniformField(sweep.name) == nullptr)
+			{
+				std::cout << "Unknown rule " << sweep.name << std::endl;
+				return false;
+			}
+
+			options.sweeps.push_back(sweep);
+			i += 3;
+		}
+		else if (arg == "--shader-cache" && hasValue)
+		{
+			std::string directory = argv[++i];
+			Simulation::SetProgramCache(directory == "none" ? "" : directory);
+		}
+		else if (arg == "--mode" && hasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "fragment") options.stepMode = Simulation::StepMode::Fragment;
+			else if (mode == "fft") options.stepMode = Simulation::StepMode::FFT;
+			else if (mode == "taps") options.stepMode = Simulation::StepMode::TapTable;
+			else if (mode == "gather") options.stepMode = Simulation::StepMode::Gather;
+			else if (mode == "compute") options.stepMode = Simulation::StepMode::Compute;
+			else if (mode == "spans") options.stepMode = Simulation::StepMode::Spans;
+			else if (mode == "gaussian") options.stepMode = Simulation::StepMode::Gaussian;
+			else if (mode == "pyramid") options.stepMode = Simulation::StepMode::Pyramid;
+			else
+			{
+				std::cout << "Unknown step mode " << mode << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--format" && hasValue)
+		{
+			std::string format = argv[++i];
+			if (format == "rgba32f") options.stateFormat = Simulation::StateFormat::RGBA32F;
+			else if (format == "r32f") options.stateFormat = Simulation::StateFormat::R32F;
+			else if (format == "r16f") options.stateFormat = Simulation::StateFormat::R16F;
+			else if (format == "r16") options.stateFormat = Simulation::StateFormat::R16;
+			else
+			{
+				std::cout << "Unknown state format " << format << std::endl;
+				return false;
+			}
+		}
+		else if (arg.rfind("--", 0) == 0 && hasValue && SetUniform(options.uniforms, arg.substr(2), (float)std::atof(argv[i + 1]))) i++;
+		else
+		{
+			std::cout << "Unknown argument " << arg << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void Report(const RunOptions& options, double seconds)
+{
+	std::cout << options.steps << " steps in " << seconds << " s, " << options.steps / seconds << " steps/s, "
+		<< seconds * 1e9 / (double(options.steps) * options.resX * options.resY) << " ns/cell" << std::endl;
+}
+
+// the largest and the mean absolute difference of two states on one line
+static void ReportError(const char* label, const std::vector<float>& exact, const std::vector<float>& approximate)
+{
+	double max = 0.0;
+	double sum = 0.0;
+	for (size_t i = 0; i < exact.size(); i++)
+	{
+		double error = std::abs(double(exact[i]) - approximate[i]);
+		max = std::max(max, error);
+		sum += error;
+	}
+
+	std::cout << ", " << label << " max " << max << " mean " << sum / exact.size();
+}
+
+static void WriteState(const std::string& path, const std::vector<float>& state)
+{
+	std::ofstream file{ path, std::ios::binary };
+	file.write((const char*)state.data(), state.size() * sizeof(float));
+}
+
+template<typename Engine>
+static int RunCpu(const RunOptions& options)
+{
+	Engine engine{ options.resX, options.resY, options.threads };
+	engine.Seed(options.seed, options.uniforms.ra);
+
+	std::cout << "CPU engine: " << options.resX << 'x' << options.resY << ", " << options.bits << " bit cells, " << engine.GetThreadCount() << " threads, " << CpuEngine::GetInstructionSet() << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < options.steps; i++)
+	{
+		engine.Step(options.uniforms);
+	}
+
+	Report(options, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	if (!options.out.empty()) WriteState(options.out, engine.GetState());
+
+	return 0;
+}
+
+static int RunHeadless(const RunOptions& options)
+{
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", options.resX, options.resY, options.resX, options.resY, true };
+
+	sim.SetUniforms(options.uniforms);
+	sim.SetStepMode(options.stepMode);
+	sim.SetGaussianTerms(options.gaussianTerms);
+	sim.SetPyramidLevel(options.pyramidLevel);
+	sim.SetSkipEmptyTiles(options.skipEmptyTiles);
+	sim.SetSpecialiseShaders(options.specialiseShaders);
+	sim.SetStateFormat(options.stateFormat);
+	sim.Init();
+	sim.Seed(options.seed);
+
+	std::cout << "Headless: " << options.resX << 'x' << options.resY << ", " << glGetString(GL_RENDERER) << std::endl;
+
+	Report(options, sim.Run(options.steps));
+
+	if (options.stepMode == Simulation::StepMode::Gaussian)
+	{
+		GaussianFit fit = FitGaussianMixture(options.uniforms.ri, options.uniforms.ra, options.gaussianTerms);
+
+		std::cout << fit.terms << " Gaussians, relative kernel error outer " << fit.outerError * 100.0f << "%, inner " << fit.innerError * 100.0f << "%, sigma";
+		for (int k = 0; k < fit.terms; k++) std::cout << ' ' << fit.sigma[k];
+		std::cout << std::endl;
+	}
+
+	if (!options.out.empty()) WriteState(options.out, sim.GetState());
+
+	return 0;
+}
+
+// runs from the same seed with the exact shader and with the step mode under test
+// reports the difference after the first step (the kernel error) and after all steps (the drift)
+// an integer ra is also run half a cell larger, the kernels have to agree off the integer radii too
+static int RunValidate(const RunOptions& options)
+{
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", options.resX, options.resY, options.resX, options.resY, true };
+
+	sim.SetUniforms(options.uniforms);
+	sim.SetGaussianTerms(options.gaussianTerms);
+	sim.SetPyramidLevel(options.pyramidLevel);
+	sim.SetStateFormat(options.stateFormat);
+	sim.Init();
+
+	std::cout << "Validate: " << options.resX << 'x' << options.resY << ", " << options.steps << " steps, " << glGetString(GL_RENDERER) << std::endl;
+
+	const unsigned int seeds[] = { 1, 2, 3 };
+	const Simulation::StepMode modes[] = { Simulation::StepMode::Fragment, options.stepMode };
+
+	std::vector<float> radii{ options.uniforms.ra };
+	if (options.uniforms.ra == std::floor(options.uniforms.ra)) radii.push_back(options.uniforms.ra + 0.5f);
+
+	for (float ra : radii)
+	{
+		for (unsigned int seed : seeds)
+		{
+			std::vector<float> first[2];
+			std::vector<float> last[2];
+			double seconds[2];
+
+			for (int i = 0; i < 2; i++)
+			{
+				// the reference steps every cell with the generic program and evaluates the transition
+				Uniforms uniforms = options.uniforms;
+				uniforms.ra = ra;
+				uniforms.useTransitionLut = i == 1 ? options.uniforms.useTransitionLut : 0;
+
+				sim.SetUniforms(uniforms);
+				sim.SetStepMode(modes[i]);
+				sim.SetSkipEmptyTiles(i == 1 && options.skipEmptyTiles);
+				sim.SetSpecialiseShaders(i == 1 && options.specialiseShaders);
+				sim.Seed(seed);
+
+				seconds[i] = sim.Run(1);
+				first[i] = sim.GetState();
+				seconds[i] += options.steps > 1 ? sim.Run(options.steps - 1) : 0.0;
+				last[i] = sim.GetState();
+			}
+
+			std::cout << "seed " << seed << " ra " << ra;
+			ReportError("first step", first[0], first[1]);
+			ReportError("last step", last[0], last[1]);
+			std::cout << ", " << seconds[0] / seconds[1] << "x faster" << std::endl;
+		}
+	}
+
+	return 0;
+}
+
+// runs the fixed point engines and the exact shader from the same seeds
+// reports the difference after the first step (the rounding of the state) and after all steps (the drift)
+// and the speed of every engine against the float CpuEngine
+static int RunQuantized(const RunOptions& options)
+{
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", options.resX, options.resY, options.resX, options.resY, true };
+
+	Uniforms exact = options.uniforms;
+	exact.useTransitionLut = 0;
+
+	sim.SetUniforms(exact);
+	sim.SetSkipEmptyTiles(false);
+	sim.SetSpecialiseShaders(false);
+	sim.Init();
+
+	std::cout << "Quantized: " << options.resX << 'x' << options.resY << ", " << options.steps << " steps, " << glGetString(GL_RENDERER) << ", " << CpuEngine::GetInstructionSet() << std::endl;
+
+	const unsigned int seeds[] = { 1, 2, 3 };
+
+	for (unsigned int seed : seeds)
+	{
+		sim.Seed(seed);
+		sim.Run(1);
+		std::vector<float> first = sim.GetState();
+		if (options.steps > 1) sim.Run(options.steps - 1);
+		std::vector<float> last = sim.GetState();
+
+		// the same steps on a native engine, first and last state and the seconds of all steps
+		auto run = [&options, seed](auto& engine, std::vector<float>& engineFirst, std::vector<float>& engineLast)
+		{
+			engine.Seed(seed, options.uniforms.ra);
+
+			auto start = std::chrono::steady_clock::now();
+			engine.Step(options.uniforms);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			engineFirst = engine.GetState();
+
+			start = std::chrono::steady_clock::now();
+			for (unsigned int i = 1; i < options.steps; i++) engine.Step(options.uniforms);
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			engineLast = engine.GetState();
+
+			return seconds;
+		};
+
+		std::vector<float> engineFirst;
+		std::vector<float> engineLast;
+
+		CpuEngine floatEngine{ options.resX, options.resY, options.threads };
+		double floatSeconds = run(floatEngine, engineFirst, engineLast);
+
+		std::cout << "seed " << seed << " float";
+		ReportError("first step", first, engineFirst);
+		ReportError("last step", last, engineLast);
+		std::cout << ", " << options.steps / floatSeconds << " steps/s" << std::endl;
+
+		QuantizedEngine16 engine16{ options.resX, options.resY, options.threads };
+		double seconds16 = run(engine16, engineFirst, engineLast);
+
+		std::cout << "seed " << seed << " u16";
+		ReportError("first step", first, engineFirst);
+		ReportError("last step", last, engineLast);
+		std::cout << ", " << floatSeconds / seconds16 << "x faster" << std::endl;
+
+		QuantizedEngine8 engine8{ options.resX, options.resY, options.threads };
+		double seconds8 = run(engine8, engineFirst, engineLast);
+
+		std::cout << "seed " << seed << " u8";
+		ReportError("first step", first, engineFirst);
+		ReportError("last step", last, engineLast);
+		std::cout << ", " << floatSeconds / seconds8 << "x faster" << std::endl;
+	}
+
+	return 0;
+}
+
+// the universes differ by the swept rules and, in an ensemble, by their seeds
+static std::vector<Uniforms> BatchUniverses(const RunOptions& options)
+{
+	std::vector<Uniforms> universes(options.universes, options.uniforms);
+
+	for (unsigned int i = 0; i < options.universes; i++)
+	{
+		float t = options.universes > 1 ? float(i) / float(options.universes - 1) : 0.0f;
+
+		for (const RunOptions::Sweep& sweep : options.sweeps)
+		{
+			universes[i].*UniformField(sweep.name) = sweep.from + (sweep.to - sweep.from) * t;
+		}
+	}
+
+	return universes;
+}
+
+static void ReportBatch(const RunOptions& options, const std::vector<Uniforms>& universes, double seconds, const std::function<std::vector<float>(unsigned int)>& getState)
+{
+	double universeSteps = double(options.steps) * options.universes;
+
+	std::cout << options.steps << " steps in " << seconds << " s, " << universeSteps / seconds << " universe-steps/s, "
+		<< seconds * 1e9 / (universeSteps * options.resX * options.resY) << " ns/cell" << std::endl;
+
+	std::ofstream out;
+	if (!options.out.empty()) out.open(options.out, std::ios::binary);
+
+	CpuKernels::Select();
+
+	for (unsigned int i = 0; i < options.universes; i++)
+	{
+		std::vector<float> cells = getState(i);
+		CpuKernels::Summary summary = CpuKernels::Summarise(cells.data(), cells.size());
+
+		std::cout << "universe " << i;
+		for (const RunOptions::Sweep& sweep : options.sweeps)
+		{
+			std::cout << ' ' << sweep.name << ' ' << universes[i].*UniformField(sweep.name);
+		}
+		std::cout << ", mean state " << summary.sum / cells.size() << ", min " << summary.min << ", max " << summary.max << std::endl;
+
+		if (out) out.write((const char*)cells.data(), cells.size() * sizeof(float));
+	}
+}
+
+static int RunBatch(const RunOptions& options)
+{
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", options.resX, options.resY, options.resX, options.resY, true };
+
+	std::vector<Uniforms> universes = BatchUniverses(options);
+
+	sim.SetStateFormat(options.stateFormat);
+	sim.Init();
+	sim.InitBatch(universes, options.packed);
+	sim.SeedBatch(options.seed, options.ensemble);
+
+	std::cout << "Batch: " << options.universes << (options.packed ? " packed" : "") << " universes of " << options.resX << 'x' << options.resY << ", " << glGetString(GL_RENDERER) << std::endl;
+
+	double seconds = sim.RunBatch(options.steps);
+
+	ReportBatch(options, universes, seconds, [&sim](unsigned int i) { return sim.GetBatchState(i); });
+
+	return 0;
+}
+
+static int RunCpuBatch(const RunOptions& options)
 {
-	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/passthrough.frag", "./shaders/brush.frag", 1280, 720, 1280, 720};
+	std::vector<Uniforms> universes = BatchUniverses(options);
+
+	std::vector<unsigned int> seeds(options.universes);
+	for (unsigned int i = 0; i < options.universes; i++) seeds[i] = options.ensemble ? options.seed + i : options.seed;
+
+	EnsembleEngine engine{ options.resX, options.resY, universes, seeds, options.threads };
+
+	std::cout << "CPU batch: " << options.universes << " universes of " << options.resX << 'x' << options.resY << ", " << engine.GetThreadCount() << " threads, "
+		<< EnsembleEngine::LANES << " universes per vector, " << CpuEngine::GetInstructionSet() << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < options.steps; i++)
+	{
+		engine.Step();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ReportBatch(options, universes, seconds, [&engine](unsigned int i) { return engine.GetState(i); });
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	std::string command = argc > 1 ? argv[1] : "";
+
+	Trace::SetThreadName("Main");
+
+	if (command == "--cpu" || command == "--headless" || command == "--validate" || command == "--quantized" || command == "--batch" || command == "--cpu-batch")
+	{
+		RunOptions options;
+		if (!ParseOptions(argc, argv, options)) return 1;
+
+		int result;
+		if (command == "--validate") result = RunValidate(options);
+		else if (command == "--quantized") result = RunQuantized(options);
+		else if (command == "--batch") result = RunBatch(options);
+		else if (command == "--cpu-batch") result = RunCpuBatch(options);
+		else if (command == "--cpu" && options.bits == 16) result = RunCpu<QuantizedEngine16>(options);
+		else if (command == "--cpu" && options.bits == 8) result = RunCpu<QuantizedEngine8>(options);
+		else result = command == "--cpu" ? RunCpu<CpuEngine>(options) : RunHeadless(options);
+
+		if (!options.trace.empty() && !Trace::Write(options.trace)) std::cout << "Cannot write " << options.trace << std::endl;
+
+		return result;
+	}
+
+	Simulation sim{ "./shaders/default.vert", "./shaders/simulation.vert", "./shaders/simulation.frag", "./shaders/brush.frag", 1280, 720, 1280, 720};
 
 	sim.Init();
 
 	sim.MainLoop();
 
 	return 0;
-}
\ No newline at end of file
+}
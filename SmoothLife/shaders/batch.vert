@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec2 coords;
+layout (location = 1) in vec2 uvcoords;
+
+out vec2 vertexUv;
+flat out int vertexLayer;
+
+// one instance of the quad per universe, batch.geom sends it to its layer
+void main()
+{
+	gl_Position = vec4(coords, 0.0, 1.0);
+	vertexUv = uvcoords;
+	vertexLayer = gl_InstanceID;
+}
@@ -25,7 +25,7 @@ void main()
 	vec2 p = toPixel(uv - vec2(xy.x, 1.0 - xy.y));
 	
 	if(p.x * p.x + p.y * p.y <= r * r && p.x * p.x + p.y * p.y > ir * ir)
-		colorOut = vec4(0.0,0.0,0.0,value); // state info in alpha channel
+		colorOut = vec4(value); // state info in the red channel
 	else
 		colorOut = vec4(0.0,0.0,0.0,0.0);
 		
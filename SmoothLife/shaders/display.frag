@@ -0,0 +1,18 @@
+#version 330 core
+
+// colours the state for the screen
+// the state is kept in the red channel so any texture format works
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+uniform vec3 color;
+
+void main()
+{
+	float state = texture(textureIn, uv).r;
+
+	FragColor = vec4(vec3(state) * color, 1.0);
+}
@@ -0,0 +1,57 @@
+#version 330 core
+
+// one pass of a mixed radix Stockham FFT along the rows or the columns
+// every output reads R inputs so the passes autosort and no bit reversal is needed
+// https://www.microsoft.com/en-us/research/wp-content/uploads/2016/02/fftgpusc08.pdf
+
+out vec4 FragColor;
+
+// complex values in .xy
+// or the state in .r when fromState is set
+uniform sampler2D textureIn;
+
+uniform int R;  // radix of this pass
+uniform int Ns; // product of the radices of the previous passes
+uniform int N;  // length of the transformed axis
+uniform int axis; // 0 = rows, 1 = columns
+uniform float direction; // -1 = forward, 1 = inverse
+uniform bool fromState;
+
+const float PI = 3.14159265;
+
+vec2 fetch(ivec2 p)
+{
+	vec4 texel = texelFetch(textureIn, p, 0);
+	return fromState ? vec2(texel.r, 0.0) : texel.xy;
+}
+
+vec2 cmul(vec2 a, vec2 b)
+{
+	return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	int i = p[axis];
+
+	// i = (j / Ns) * Ns * R + r * Ns + j % Ns
+	int span = Ns * R;
+	int k = i % span; // (j % Ns) + r * Ns
+	int j = (i / span) * Ns + i % Ns;
+	int stride = N / R;
+
+	// twiddle and R point DFT combined into a single angle per input
+	vec2 sum = vec2(0.0);
+	for(int s = 0; s < R; s++)
+	{
+		ivec2 q = p;
+		q[axis] = j + s * stride;
+
+		// reduce before converting to float to keep the angle exact
+		float angle = direction * 2.0 * PI * float((s * k) % span) / float(span);
+		sum += cmul(fetch(q), vec2(cos(angle), sin(angle)));
+	}
+
+	FragColor = vec4(sum, 0.0, 0.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// pointwise product of the state spectrum and the kernel spectrum
+
+out vec4 FragColor;
+
+uniform sampler2D textureIn;
+uniform sampler2D kernelIn;
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+
+	vec2 a = texelFetch(textureIn, p, 0).xy;
+	vec2 b = texelFetch(kernelIn, p, 0).xy;
+
+	FragColor = vec4(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x, 0.0, 0.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+
+// applies the transition to the ring sums computed by the FFT step
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+// unnormalised inverse transform
+// x = outer ring sum, y = inner ring sum
+uniform sampler2D convolution;
+uniform float scale; // 1 / (resolution.x * resolution.y)
+
+#include "rules.glsl"
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+
+	// the kernels are already normalised
+	vec2 f = texelFetch(convolution, p, 0).xy * scale;
+	float v = texelFetch(textureIn, p, 0).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
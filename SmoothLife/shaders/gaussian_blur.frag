@@ -0,0 +1,37 @@
+#version 330 core
+
+// one direction of up to four truncated Gaussian blurs at once, one per channel
+// the horizontal pass blurs the state into every channel, the vertical pass blurs each channel on its own
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+uniform bool fromState;
+uniform ivec2 direction; // (1, 0) or (0, 1)
+uniform ivec2 resolution;
+
+// |i| -> exp(-i^2 / (2 sigma^2)) of each Gaussian, 0 past its 3 sigma radius
+uniform samplerBuffer weights;
+uniform int radius; // largest radius of the four
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	vec4 res = vec4(0.0);
+
+	// % is undefined for negative operands, the radius may be wider than the grid
+	ivec2 base = p + resolution * (radius / min(resolution.x, resolution.y) + 1);
+
+	for(int i = -radius; i <= radius; i++)
+	{
+		ivec2 q = (base + direction * i) % resolution;
+		vec4 v = fromState ? vec4(texelFetch(textureIn, q, 0).r) : texelFetch(textureIn, q, 0);
+
+		res += texelFetch(weights, abs(i)) * v;
+	}
+
+	FragColor = res;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// applies the transition to the ring sums mixed from the blurred state
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+// one Gaussian per channel
+uniform sampler2D blurred;
+uniform vec4 outerWeights;
+uniform vec4 innerWeights;
+
+#include "rules.glsl"
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+
+	// the weights are already normalised
+	vec4 g = texelFetch(blurred, p, 0);
+	vec2 f = vec2(dot(outerWeights, g), dot(innerWeights, g));
+	float v = texelFetch(textureIn, p, 0).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
@@ -1,12 +0,0 @@
-#version 330 core
-
-out vec4 FragColor;
-
-in vec2 uv;
-
-uniform sampler2D textureIn;
-
-void main()
-{
-	FragColor = texture(textureIn, uv);
-}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 330 core
+
+// one level of the box pyramid, texel p holds the mean of the 2^k x 2^k cells from p to p + 2^k - 1
+// the four quarters of the block are texels of the level below, half a block apart
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+// the level below, the state for level 1
+uniform sampler2D textureIn;
+
+uniform vec2 resolution;
+
+// 2^(k - 1)
+uniform int halfSize;
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	ivec2 size = ivec2(resolution);
+
+	float sum = texelFetch(textureIn, p, 0).r
+		+ texelFetch(textureIn, (p + ivec2(halfSize, 0)) % size, 0).r
+		+ texelFetch(textureIn, (p + ivec2(0, halfSize)) % size, 0).r
+		+ texelFetch(textureIn, (p + ivec2(halfSize)) % size, 0).r;
+
+	FragColor = vec4(0.25 * sum);
+}
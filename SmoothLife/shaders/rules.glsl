@@ -0,0 +1,89 @@
+// SmoothLife transition rules shared by every step implementation
+// https://arxiv.org/pdf/1111.1567
+
+const float PI = 3.14159265;
+
+layout(std140) uniform SimData
+{
+	uniform float ri; // inner radius
+	uniform float ra; // outer radius
+	
+	uniform float dt;
+	
+	// width of the step
+	uniform float alpha_m;
+	uniform float alpha_n;
+	
+	// birth and death intervals
+	// [b1, b2] birth
+	// [d1, d2] death
+	uniform float b1;
+	uniform float b2;
+	uniform float d1;
+	uniform float d2;
+
+	// != 0 reads transition() from transitionLut instead of evaluating the sigmoids
+	uniform int useTransitionLut;
+};
+
+// a specialised program has the rules baked in as constants (Simulation::ShaderVariants)
+// so the compiler can unroll the convolution and fold the kernel weights
+#ifdef SPECIALISED
+#define RI SPECIALISED_RI
+#define RA SPECIALISED_RA
+#define DT SPECIALISED_DT
+#define ALPHA_M SPECIALISED_ALPHA_M
+#define ALPHA_N SPECIALISED_ALPHA_N
+#define B1 SPECIALISED_B1
+#define B2 SPECIALISED_B2
+#define D1 SPECIALISED_D1
+#define D2 SPECIALISED_D2
+#else
+#define RI ri
+#define RA ra
+#define DT dt
+#define ALPHA_M alpha_m
+#define ALPHA_N alpha_n
+#define B1 b1
+#define B2 b2
+#define D1 d1
+#define D2 d2
+#endif
+
+// transitionAnalytic() over [0, 1]^2, x = outer, y = inner, texel centres on both ends
+// rendered by transition_lut.frag whenever the rules change
+uniform sampler2D transitionLut;
+
+// use smooth step sigmoid functions
+
+float sigmoid1(float x, float a, float al)
+{
+	return 1.0/(1.0 + exp(-(x-a) * 4.0 / al));
+}
+
+float sigmoid2(float x, float a, float b, float al)
+{
+	return sigmoid1(x,a, al) * (1.0 - sigmoid1(x,b, al));
+}
+
+float sigmoidm(float x, float y, float m, float al)
+{
+	return x * (1.0 - sigmoid1(m, 0.5, al))+ y * sigmoid1(m, 0.5, al);
+}
+
+// m := inner radius, n := outer radius
+float transitionAnalytic(vec2 f) 
+{
+	return sigmoid2(f.x, sigmoidm(B1, D1, f.y, ALPHA_M), sigmoidm(B2, D2, f.y, ALPHA_M), ALPHA_N);
+	//return sigmoidm(sigmoid2(f.x,b1, b2, alpha_n), sigmoid2(f.x,d1,d2 ,alpha_n), f.y, alpha_m);
+	//return sigmoid2(f.x, sigmoidm(f.y,b1, d1, alpha_m), sigmoidm(f.y,b2,d2,alpha_m), alpha_n);
+}
+
+float transition(vec2 f)
+{
+	if(useTransitionLut == 0) return transitionAnalytic(f);
+
+	// bilinear, textureLod because compute shaders have no derivatives
+	vec2 size = vec2(textureSize(transitionLut, 0));
+	return textureLod(transitionLut, (clamp(f, 0.0, 1.0) * (size - 1.0) + 0.5) / size, 0.0).r;
+}
@@ -13,54 +13,7 @@ uniform sampler2D textureIn;
 uniform vec2 resolution;
 uniform vec2 invResolution;
 
-
-
-const float PI = 3.14159265;
-
-layout(std140) uniform SimData
-{
-	uniform float ri; // inner radius
-	uniform float ra; // outer radius
-	
-	uniform float dt;
-	
-	// width of the step
-	uniform float alpha_m;
-	uniform float alpha_n;
-	
-	// birth and death intervals
-	// [b1, b2] birth
-	// [d1, d2] death
-	uniform float b1;
-	uniform float b2;
-	uniform float d1;
-	uniform float d2;
-};
-
-// use smooth step sigmoid functions
-
-float sigmoid1(float x, float a, float al)
-{
-	return 1.0/(1.0 + exp(-(x-a) * 4.0 / al));
-}
-
-float sigmoid2(float x, float a, float b, float al)
-{
-	return sigmoid1(x,a, al) * (1.0 - sigmoid1(x,b, al));
-}
-
-float sigmoidm(float x, float y, float m, float al)
-{
-	return x * (1.0 - sigmoid1(m, 0.5, al))+ y * sigmoid1(m, 0.5, al);
-}
-
-// m := inner radius, n := outer radius
-float transition(vec2 f) 
-{
-	return sigmoid2(f.x, sigmoidm(b1, d1, f.y, alpha_m), sigmoidm(b2,d2, f.y,alpha_m), alpha_n);
-	//return sigmoidm(sigmoid2(f.x,b1, b2, alpha_n), sigmoid2(f.x,d1,d2 ,alpha_n), f.y, alpha_m);
-	//return sigmoid2(f.x, sigmoidm(f.y,b1, d1, alpha_m), sigmoidm(f.y,b2,d2,alpha_m), alpha_n);
-}
+#include "rules.glsl"
 
 // use antialiasing to remove jagged edges
 
@@ -87,9 +40,12 @@ vec2 convolve(vec2 r)
 {
 	vec2 res = vec2(0.0);
 
-	for(float y = -r.x; y <= r.x; y++)
+	// whole cell offsets for any ra, the same lattice as BuildKernelTaps() in Rules.h
+	float n = ceil(r.x);
+
+	for(float y = -n; y <= n; y++)
 	{
-		for(float x = -r.x; x <= r.x; x++)
+		for(float x = -n; x <= n; x++)
 		{
 			float lsq = x * x + y * y;
 
@@ -101,7 +57,7 @@ vec2 convolve(vec2 r)
 				vec2 d = vec2(x, y);
 				vec2 offset = d * invResolution;
 				vec2 spos = fract(uv + offset);
-				float v = texture(textureIn, spos).w; // store state information in alpha channel
+				float v = texture(textureIn, spos).r; // state information in the red channel
 
 				// temp solution
 				// TODO: change to a step function
@@ -116,28 +72,21 @@ vec2 convolve(vec2 r)
 	return res;
 }
 
-uniform vec3 color;
-
 void main()
 {
-	vec2 rad = vec2(ra, ri);
+	vec2 rad = vec2(RA, RI);
 
 	vec2 f = convolve(rad);
 
 	// normalise
 	f /= PI * rad * rad;
-	float v = texture(textureIn, uv).w;
+	float v = texture(textureIn, uv).r;
 
-	float state = v + dt * (2.0 * transition(f) - 1.0);
+	float state = v + DT * (2.0 * transition(f) - 1.0);
 	state = clamp(state, 0.0, 1.0);
 
 	//float state = transition(f);
 
-	//FragColor = vec4(state) * color;
-	//FragColor = vec4(state,state*m,state*n,state);
-	//FragColor = vec4(state,m,n,state);
-	//FragColor = vec4(0.0,n*m,state,state);
-	//FragColor = vec4(state,m,state,state) * color;
-
-	FragColor = vec4(vec3(state) * color + vec3(f.y) * color + vec3(f.x) * color, state);
+	// the state texture may only have a red channel, colour is applied by display.frag
+	FragColor = vec4(state);
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#version 330 core
+
+// simulation.frag for one layer of a texture array, every layer is an independent universe
+// with its own rules, read from the parameter buffer instead of the SimData block
+
+out vec4 FragColor;
+
+in vec2 uv;
+flat in int layer;
+
+uniform sampler2DArray textureIn;
+
+// three texels per universe, the fields of Uniforms in order
+// (ri, ra, dt, alpha_m) (alpha_n, b1, b2, d1) (d2, -, -, -)
+uniform samplerBuffer parameters;
+
+uniform vec2 invResolution;
+
+float universeRi;
+float universeRa;
+float universeDt;
+float universeAlphaM;
+float universeAlphaN;
+float universeB1;
+float universeB2;
+float universeD1;
+float universeD2;
+
+// the rules read the universe instead of the uniform block
+#define SPECIALISED
+#define SPECIALISED_RI universeRi
+#define SPECIALISED_RA universeRa
+#define SPECIALISED_DT universeDt
+#define SPECIALISED_ALPHA_M universeAlphaM
+#define SPECIALISED_ALPHA_N universeAlphaN
+#define SPECIALISED_B1 universeB1
+#define SPECIALISED_B2 universeB2
+#define SPECIALISED_D1 universeD1
+#define SPECIALISED_D2 universeD2
+
+#include "rules.glsl"
+
+const float b = 1.0;
+
+float ramp(float l, float r)
+{
+	return clamp(-l/b + (r + b/2.0)/b,0.0,1.0);
+}
+
+// same sums as convolve() in simulation.frag
+vec2 convolve(vec2 r)
+{
+	vec2 res = vec2(0.0);
+
+	float n = ceil(r.x);
+
+	for(float y = -n; y <= n; y++)
+	{
+		for(float x = -n; x <= n; x++)
+		{
+			float lsq = x * x + y * y;
+
+			if(lsq <= r.x * r.x)
+			{
+				vec2 spos = fract(uv + vec2(x, y) * invResolution);
+				float v = texture(textureIn, vec3(spos, layer)).r;
+
+				if(lsq <= r.y * r.y)
+					res.y += ramp(sqrt(lsq), r.y) * v;
+				else
+					res.x += ramp(sqrt(lsq), r.x) * v;
+			}
+		}
+	}
+
+	return res;
+}
+
+void main()
+{
+	vec4 p0 = texelFetch(parameters, layer * 3);
+	vec4 p1 = texelFetch(parameters, layer * 3 + 1);
+	vec4 p2 = texelFetch(parameters, layer * 3 + 2);
+
+	universeRi = p0.x;
+	universeRa = p0.y;
+	universeDt = p0.z;
+	universeAlphaM = p0.w;
+	universeAlphaN = p1.x;
+	universeB1 = p1.y;
+	universeB2 = p1.z;
+	universeD1 = p1.w;
+	universeD2 = p2.x;
+
+	vec2 rad = vec2(RA, RI);
+
+	vec2 f = convolve(rad);
+
+	f /= PI * rad * rad;
+	float v = texture(textureIn, vec3(uv, layer)).r;
+
+	// the lookup texture only holds the rules of the main simulation
+	float state = v + DT * (2.0 * transitionAnalytic(f) - 1.0);
+
+	FragColor = vec4(clamp(state, 0.0, 1.0));
+}
@@ -0,0 +1,120 @@
+#version 330 core
+
+// simulation_batch.frag with four universes per texel, one in each channel
+// the four share ri and ra so a single fetch per tap feeds all four ring sums
+
+out vec4 FragColor;
+
+in vec2 uv;
+flat in int layer;
+
+uniform sampler2DArray textureIn;
+
+// three texels per universe, the fields of Uniforms in order
+// (ri, ra, dt, alpha_m) (alpha_n, b1, b2, d1) (d2, -, -, -)
+// universe 4 * layer + c lives in channel c
+uniform samplerBuffer parameters;
+
+uniform vec2 invResolution;
+
+float universeRi;
+float universeRa;
+float universeDt;
+float universeAlphaM;
+float universeAlphaN;
+float universeB1;
+float universeB2;
+float universeD1;
+float universeD2;
+
+// the rules read the current universe instead of the uniform block
+#define SPECIALISED
+#define SPECIALISED_RI universeRi
+#define SPECIALISED_RA universeRa
+#define SPECIALISED_DT universeDt
+#define SPECIALISED_ALPHA_M universeAlphaM
+#define SPECIALISED_ALPHA_N universeAlphaN
+#define SPECIALISED_B1 universeB1
+#define SPECIALISED_B2 universeB2
+#define SPECIALISED_D1 universeD1
+#define SPECIALISED_D2 universeD2
+
+#include "rules.glsl"
+
+void loadUniverse(int universe)
+{
+	vec4 p0 = texelFetch(parameters, universe * 3);
+	vec4 p1 = texelFetch(parameters, universe * 3 + 1);
+	vec4 p2 = texelFetch(parameters, universe * 3 + 2);
+
+	universeRi = p0.x;
+	universeRa = p0.y;
+	universeDt = p0.z;
+	universeAlphaM = p0.w;
+	universeAlphaN = p1.x;
+	universeB1 = p1.y;
+	universeB2 = p1.z;
+	universeD1 = p1.w;
+	universeD2 = p2.x;
+}
+
+const float b = 1.0;
+
+float ramp(float l, float r)
+{
+	return clamp(-l/b + (r + b/2.0)/b,0.0,1.0);
+}
+
+// same sums as convolve() in simulation.frag, for every channel at once
+void convolve(vec2 r, out vec4 outer, out vec4 inner)
+{
+	outer = vec4(0.0);
+	inner = vec4(0.0);
+
+	float n = ceil(r.x);
+
+	for(float y = -n; y <= n; y++)
+	{
+		for(float x = -n; x <= n; x++)
+		{
+			float lsq = x * x + y * y;
+
+			if(lsq <= r.x * r.x)
+			{
+				vec2 spos = fract(uv + vec2(x, y) * invResolution);
+				vec4 v = texture(textureIn, vec3(spos, layer));
+
+				if(lsq <= r.y * r.y)
+					inner += ramp(sqrt(lsq), r.y) * v;
+				else
+					outer += ramp(sqrt(lsq), r.x) * v;
+			}
+		}
+	}
+}
+
+void main()
+{
+	// the radii of the first universe are the radii of all four
+	loadUniverse(layer * 4);
+
+	vec2 rad = vec2(RA, RI);
+
+	vec4 outer;
+	vec4 inner;
+	convolve(rad, outer, inner);
+
+	outer /= PI * rad.x * rad.x;
+	inner /= PI * rad.y * rad.y;
+
+	vec4 v = texture(textureIn, vec3(uv, layer));
+	vec4 state;
+
+	for(int c = 0; c < 4; c++)
+	{
+		loadUniverse(layer * 4 + c);
+		state[c] = v[c] + DT * (2.0 * transitionAnalytic(vec2(outer[c], inner[c])) - 1.0);
+	}
+
+	FragColor = clamp(state, 0.0, 1.0);
+}
@@ -0,0 +1,86 @@
+#version 330 core
+#extension GL_ARB_texture_gather : enable
+
+// convolve() of simulation.frag reading 2x2 texel quads per fetch
+// the state textures wrap with GL_REPEAT so the quads need no fract()
+// without texture gather the quad is read with four texelFetch calls instead
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+uniform vec2 resolution;
+uniform vec2 invResolution;
+
+#include "rules.glsl"
+
+// texels (p.x, p.y + 1), (p.x + 1, p.y + 1), (p.x + 1, p.y), (p.x, p.y) in textureGather order
+vec4 quad(ivec2 p)
+{
+#ifdef GL_ARB_texture_gather
+	// the shared corner of the four texel centres
+	return textureGather(textureIn, vec2(p + 1) * invResolution);
+#else
+	// % is undefined for negative operands, p is never below -resolution
+	ivec2 res = ivec2(resolution);
+	ivec2 p0 = (p + res) % res;
+	ivec2 p1 = (p0 + 1) % res;
+
+	return vec4(
+		texelFetch(textureIn, ivec2(p0.x, p1.y), 0).r,
+		texelFetch(textureIn, ivec2(p1.x, p1.y), 0).r,
+		texelFetch(textureIn, ivec2(p1.x, p0.y), 0).r,
+		texelFetch(textureIn, ivec2(p0.x, p0.y), 0).r);
+#endif
+}
+
+// x = outer
+// y = inner
+vec2 convolve()
+{
+	vec2 res = vec2(0.0);
+	ivec2 p = ivec2(gl_FragCoord.xy);
+
+	// the quads cover [-r, r + 1], the extra row and column fall outside ra and weigh 0
+	int r = int(ceil(ra));
+
+	for(int y = -r; y <= r; y += 2)
+	{
+		for(int x = -r; x <= r; x += 2)
+		{
+			vec4 v = quad(p + ivec2(x, y));
+
+			// per texel weights, same antialiased rim as ramp() in simulation.frag
+			vec4 dx = vec4(x, x + 1, x + 1, x);
+			vec4 dy = vec4(y + 1, y + 1, y, y);
+			vec4 lsq = dx * dx + dy * dy;
+			vec4 l = sqrt(lsq);
+
+			vec4 inner = vec4(lessThanEqual(lsq, vec4(ri * ri)));
+			vec4 outer = vec4(lessThanEqual(lsq, vec4(ra * ra))) - inner;
+
+			res.y += dot(inner * clamp(ri + 0.5 - l, 0.0, 1.0), v);
+			res.x += dot(outer * clamp(ra + 0.5 - l, 0.0, 1.0), v);
+		}
+	}
+
+	return res;
+}
+
+void main()
+{
+	vec2 rad = vec2(ra, ri);
+
+	vec2 f = convolve();
+
+	// normalise
+	f /= PI * rad * rad;
+	float v = texelFetch(textureIn, ivec2(gl_FragCoord.xy), 0).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
@@ -0,0 +1,88 @@
+#version 330 core
+
+// convolve() of simulation.frag with the middle of the outer annulus read from a box pyramid
+// cells near ri and ra are exact taps, the rest of the annulus is covered by square blocks
+// and each block is one fetch from the level of its size at the pixel plus the block corner
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+// level k holds the mean of the 2^k x 2^k block from every texel on (pyramid_box.frag)
+uniform sampler2D level1;
+uniform sampler2D level2;
+uniform sampler2D level3;
+uniform sampler2D level4;
+uniform sampler2D level5;
+uniform sampler2D level6;
+
+// exact taps first: xy = offset, zw = (outer, inner) weight
+// then the blocks of level 1 to 6: xy = offset of the lower left cell, z = outer weight of the whole block
+uniform samplerBuffer table;
+uniform int tapCount;
+
+// end of the blocks of every level in the table
+uniform int level1End;
+uniform int level2End;
+uniform int level3End;
+uniform int level4End;
+uniform int level5End;
+uniform int level6End;
+
+uniform vec2 resolution;
+uniform vec2 invResolution;
+
+#include "rules.glsl"
+
+float blocks(sampler2D level, int begin, int end, ivec2 p, ivec2 size)
+{
+	float sum = 0.0;
+
+	for(int i = begin; i < end; i++)
+	{
+		vec4 block = texelFetch(table, i);
+		sum += block.z * texelFetch(level, (p + ivec2(block.xy) + size) % size, 0).r;
+	}
+
+	return sum;
+}
+
+// x = outer
+// y = inner
+vec2 convolve()
+{
+	vec2 res = vec2(0.0);
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	ivec2 size = ivec2(resolution);
+
+	for(int i = 0; i < tapCount; i++)
+	{
+		vec4 tap = texelFetch(table, i);
+		ivec2 q = (p + ivec2(tap.xy) + size) % size;
+
+		res += texelFetch(textureIn, q, 0).r * tap.zw;
+	}
+
+	res.x += blocks(level1, tapCount, level1End, p, size);
+	res.x += blocks(level2, level1End, level2End, p, size);
+	res.x += blocks(level3, level2End, level3End, p, size);
+	res.x += blocks(level4, level3End, level4End, p, size);
+	res.x += blocks(level5, level4End, level5End, p, size);
+	res.x += blocks(level6, level5End, level6End, p, size);
+
+	return res;
+}
+
+void main()
+{
+	// already normalised by the weights
+	vec2 f = convolve();
+	float v = texelFetch(textureIn, ivec2(gl_FragCoord.xy), 0).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
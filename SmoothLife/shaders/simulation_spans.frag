@@ -0,0 +1,67 @@
+#version 330 core
+
+// convolve() of simulation.frag from horizontal spans of row prefix sums
+// each row of the kernel is a few spans of constant weight read with two fetches each,
+// the antialiased rim cells are added as single edge taps
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+// exclusive row prefix sums from span_scan.frag
+uniform sampler2D prefix;
+uniform int halo;
+
+// spans first: x = half width, y = row offset, zw = (outer, inner) weight
+// then edge taps: xy = offset, zw = (outer, inner) weight
+uniform samplerBuffer table;
+uniform int spanCount;
+uniform int totalCount;
+
+uniform vec2 resolution;
+
+#include "rules.glsl"
+
+// x = outer
+// y = inner
+vec2 convolve()
+{
+	vec2 res = vec2(0.0);
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	ivec2 size = ivec2(resolution);
+
+	for(int i = 0; i < spanCount; i++)
+	{
+		vec4 span = texelFetch(table, i);
+		int a = int(span.x);
+		int y = (p.y + int(span.y) + size.y) % size.y;
+
+		// cells [p.x - a, p.x + a] of the row
+		float sum = texelFetch(prefix, ivec2(p.x + a + halo + 1, y), 0).r - texelFetch(prefix, ivec2(p.x - a + halo, y), 0).r;
+		res += sum * span.zw;
+	}
+
+	for(int i = spanCount; i < totalCount; i++)
+	{
+		vec4 tap = texelFetch(table, i);
+		ivec2 q = (p + ivec2(tap.xy) + size) % size;
+
+		res += texelFetch(textureIn, q, 0).r * tap.zw;
+	}
+
+	return res;
+}
+
+void main()
+{
+	// already normalised by the weights
+	vec2 f = convolve();
+	float v = texelFetch(textureIn, ivec2(gl_FragCoord.xy), 0).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
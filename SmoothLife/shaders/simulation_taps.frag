@@ -0,0 +1,50 @@
+#version 330 core
+
+// convolve() of simulation.frag driven by a precomputed tap table
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+// one texel per tap: xy = offset in texture coordinates, z = normalised weight
+// inner disk taps first, then the outer annulus
+uniform samplerBuffer taps;
+uniform int innerTaps;
+uniform int totalTaps;
+
+#include "rules.glsl"
+
+// x = outer
+// y = inner
+vec2 convolve()
+{
+	vec2 res = vec2(0.0);
+
+	for(int i = 0; i < innerTaps; i++)
+	{
+		vec4 tap = texelFetch(taps, i);
+		res.y += tap.z * texture(textureIn, fract(uv + tap.xy)).r;
+	}
+
+	for(int i = innerTaps; i < totalTaps; i++)
+	{
+		vec4 tap = texelFetch(taps, i);
+		res.x += tap.z * texture(textureIn, fract(uv + tap.xy)).r;
+	}
+
+	return res;
+}
+
+void main()
+{
+	// already normalised by the weights
+	vec2 f = convolve();
+	float v = texture(textureIn, uv).r;
+
+	float state = v + dt * (2.0 * transition(f) - 1.0);
+	state = clamp(state, 0.0, 1.0);
+
+	FragColor = vec4(state);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+
+// one Hillis-Steele pass of the exclusive row prefix sums used by simulation_spans.frag
+// column j holds the sum of the state cells (i - halo) mod resolution.x for i in [0, j)
+// the halo on both sides lets every span be read without wrapping
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D textureIn;
+
+uniform bool fromState; // first pass, shifts the state by one cell and the halo
+uniform int offset;     // distance added this pass: 1, 2, 4, ...
+uniform int halo;
+uniform int resolutionX;
+
+void main()
+{
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	float v = 0.0;
+
+	if(fromState)
+	{
+		// halo <= resolutionX so the index stays positive
+		if(p.x > 0) v = texelFetch(textureIn, ivec2((p.x - 1 - halo + resolutionX) % resolutionX, p.y), 0).r;
+	}
+	else
+	{
+		v = texelFetch(textureIn, p, 0).r;
+		if(p.x >= offset) v += texelFetch(textureIn, p - ivec2(offset, 0), 0).r;
+	}
+
+	FragColor = vec4(v);
+}
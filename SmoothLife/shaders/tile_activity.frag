@@ -0,0 +1,30 @@
+#version 330 core
+
+// one texel per tile of the state
+// r = the front buffer has a live cell in the tile, g = the back buffer has one
+
+out vec4 FragColor;
+
+uniform sampler2D front;
+uniform sampler2D back;
+
+uniform int tileSize;
+uniform ivec2 resolution;
+
+void main()
+{
+	ivec2 origin = ivec2(gl_FragCoord.xy) * tileSize;
+	ivec2 end = min(origin + tileSize, resolution);
+
+	vec2 live = vec2(0.0);
+
+	for(int y = origin.y; y < end.y; y++)
+	{
+		for(int x = origin.x; x < end.x; x++)
+		{
+			live = max(live, vec2(texelFetch(front, ivec2(x, y), 0).r, texelFetch(back, ivec2(x, y), 0).r));
+		}
+	}
+
+	FragColor = vec4(vec2(greaterThan(live, vec2(0.0))), 0.0, 1.0);
+}
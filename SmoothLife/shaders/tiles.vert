@@ -0,0 +1,43 @@
+#version 330 core
+
+// one instance per tile of the grid, used instead of the fullscreen quad of simulation.vert
+// a tile is collapsed outside the clip volume when it and every tile within tileRadius are empty
+// and the back buffer is already empty there, the step would only write zeros over zeros
+
+layout (location = 0) in vec2 coords;
+layout (location = 1) in vec2 uvcoords;
+
+out vec2 uv;
+
+// from tile_activity.frag
+uniform sampler2D activity;
+
+uniform ivec2 tiles;
+uniform int tileSize;
+uniform int tileRadius;
+uniform vec2 resolution;
+
+void main()
+{
+	ivec2 tile = ivec2(gl_InstanceID % tiles.x, gl_InstanceID / tiles.x);
+
+	bool live = texelFetch(activity, tile, 0).g > 0.0;
+
+	// % is undefined for negative operands
+	ivec2 base = tile + tiles * (tileRadius / min(tiles.x, tiles.y) + 1);
+
+	for(int y = -tileRadius; y <= tileRadius && !live; y++)
+	{
+		for(int x = -tileRadius; x <= tileRadius && !live; x++)
+		{
+			live = texelFetch(activity, (base + ivec2(x, y)) % tiles, 0).r > 0.0;
+		}
+	}
+
+	// the corners of the quad span the tile, clipped to the grid
+	vec2 lo = vec2(tile * tileSize);
+	vec2 hi = min(lo + float(tileSize), resolution);
+
+	uv = mix(lo, hi, uvcoords) / resolution;
+	gl_Position = live ? vec4(uv * 2.0 - 1.0, 0.0, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+}
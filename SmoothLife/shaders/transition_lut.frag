@@ -0,0 +1,17 @@
+#version 330 core
+
+// samples transitionAnalytic() for the lookup texture of transition()
+// texel (0, 0) is f = (0, 0) and the last texel is f = (1, 1)
+
+out vec4 FragColor;
+
+uniform vec2 size;
+
+#include "rules.glsl"
+
+void main()
+{
+	vec2 f = (gl_FragCoord.xy - 0.5) / (size - 1.0);
+
+	FragColor = vec4(transitionAnalytic(f));
+}